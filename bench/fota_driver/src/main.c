@@ -0,0 +1,384 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Host-side benchmark of the FOTA driver.
+ *
+ * Replays the access patterns MiraMesh uses during a FOTA transfer
+ * against the flash simulator and reports throughput, flash operations
+ * per KiB and worst-case latency per driver call.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/stats/stats.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <miramesh.h>
+#include "mira_sim.h"
+#include "fota_driver.h"
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+#include "fota_write_queue.h"
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+#include "fota_write_combine.h"
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+#include "fota_read_cache.h"
+#endif
+
+#define SWAP_SIZE FIXED_PARTITION_SIZE(slot1_partition)
+#define FLASH_PAGE_SIZE 0x1000
+#define MCU_BOOT_HEADER_LOCATION PM_MCUBOOT_PAD_SIZE
+#define MIRA_HEADER_LOCATION (MCU_BOOT_HEADER_LOCATION - MIRA_FOTA_HEADER_SIZE)
+
+#define MAX_FRAGMENT_SIZE 512
+
+enum bench_op {
+    BENCH_OP_WRITE,
+    BENCH_OP_READ,
+    /* Every fragment read once per child, like a relaying node */
+    BENCH_OP_RELAY
+};
+
+struct bench_pattern {
+    const char *name;
+    uint32_t start;
+    uint32_t end;
+    uint32_t fragment_size;
+};
+
+struct flash_ops {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;
+};
+
+struct bench_result {
+    uint32_t bytes;
+    uint32_t calls;
+    uint64_t total_us;
+    uint64_t max_call_us;
+    uint64_t max_done_us;
+    struct flash_ops ops;
+    uint32_t mismatches;
+};
+
+static const mira_fota_driver_t *drv;
+static K_SEM_DEFINE(done_sem, 0, 1);
+/* Erase only reports completion when storage is non-NULL */
+static int done_storage;
+
+static uint8_t fragment[MAX_FRAGMENT_SIZE];
+static uint8_t readback[MAX_FRAGMENT_SIZE];
+
+static void bench_done(
+    void *storage)
+{
+    k_sem_give(&done_sem);
+}
+
+static int stats_collect(
+    struct stats_hdr *hdr,
+    void *arg,
+    const char *name,
+    uint16_t off)
+{
+    struct flash_ops *ops = arg;
+    uint32_t val = *(uint32_t *) ((uint8_t *) hdr + off);
+
+    if (strcmp(name, "flash_read_calls") == 0) {
+        ops->reads += val;
+    } else if (strcmp(name, "flash_write_calls") == 0) {
+        ops->writes += val;
+    } else if (strcmp(name, "flash_erase_calls") == 0) {
+        ops->erases += val;
+    }
+    return 0;
+}
+
+static void flash_ops_snapshot(
+    struct flash_ops *ops)
+{
+    struct stats_hdr *hdr = NULL;
+
+    memset(ops, 0, sizeof(*ops));
+    while ((hdr = stats_group_get_next(hdr)) != NULL) {
+        stats_walk(hdr, stats_collect, ops);
+    }
+}
+
+static void flash_ops_delta(
+    struct flash_ops *delta,
+    const struct flash_ops *before,
+    const struct flash_ops *after)
+{
+    delta->reads = after->reads - before->reads;
+    delta->writes = after->writes - before->writes;
+    delta->erases = after->erases - before->erases;
+}
+
+/* Deterministic image content, so reads can be verified */
+static uint8_t image_byte(
+    uint32_t address)
+{
+    return (uint8_t) ((address * 31) ^ (address >> 8));
+}
+
+static uint8_t expected_read_byte(
+    uint32_t address)
+{
+    if (address >= MIRA_HEADER_LOCATION && address < MCU_BOOT_HEADER_LOCATION) {
+        return 0xff;
+    }
+    return image_byte(address);
+}
+
+static uint64_t cycles_to_us(
+    uint64_t cycles)
+{
+    return k_cyc_to_us_floor64(cycles);
+}
+
+static void bench_erase(
+    struct bench_result *res)
+{
+    struct flash_ops before, after;
+
+    memset(res, 0, sizeof(*res));
+    flash_ops_snapshot(&before);
+    uint64_t start = k_cycle_get_64();
+    drv->erase(FOTA_SLOT_ID, bench_done, &done_storage);
+    uint64_t returned = k_cycle_get_64();
+    k_sem_take(&done_sem, K_FOREVER);
+    uint64_t done = k_cycle_get_64();
+    flash_ops_snapshot(&after);
+
+    res->calls = 1;
+    res->bytes = SWAP_SIZE;
+    res->total_us = cycles_to_us(done - start);
+    res->max_call_us = cycles_to_us(returned - start);
+    res->max_done_us = res->total_us;
+    flash_ops_delta(&res->ops, &before, &after);
+}
+
+static void bench_call(
+    const struct bench_pattern *pattern,
+    enum bench_op op,
+    uint32_t address,
+    uint32_t length,
+    struct bench_result *res)
+{
+    int ret;
+
+    if (op == BENCH_OP_WRITE) {
+        for (uint32_t i = 0; i < length; i++) {
+            fragment[i] = image_byte(address + i);
+        }
+    }
+
+    uint64_t start = k_cycle_get_64();
+    if (op == BENCH_OP_WRITE) {
+        ret = drv->write(FOTA_SLOT_ID, fragment, address, length,
+            bench_done, &done_storage);
+    } else {
+        ret = drv->read(FOTA_SLOT_ID, readback, address, length,
+            bench_done, &done_storage);
+    }
+    uint64_t returned = k_cycle_get_64();
+    if (ret != 0) {
+        printf("%s: call failed at 0x%x: %d\n", pattern->name, address, ret);
+        res->mismatches++;
+        return;
+    }
+    k_sem_take(&done_sem, K_FOREVER);
+    uint64_t done = k_cycle_get_64();
+
+    res->calls++;
+    res->bytes += length;
+    res->total_us += cycles_to_us(done - start);
+    res->max_call_us = MAX(res->max_call_us, cycles_to_us(returned - start));
+    res->max_done_us = MAX(res->max_done_us, cycles_to_us(done - start));
+
+    if (op != BENCH_OP_WRITE) {
+        for (uint32_t i = 0; i < length; i++) {
+            if (readback[i] != expected_read_byte(address + i)) {
+                res->mismatches++;
+            }
+        }
+    }
+}
+
+static void bench_run(
+    const struct bench_pattern *pattern,
+    enum bench_op op,
+    struct bench_result *res)
+{
+    struct flash_ops before, after;
+    uint32_t repeat = op == BENCH_OP_RELAY ? CONFIG_FOTA_BENCH_RELAY_CHILDREN : 1;
+
+    memset(res, 0, sizeof(*res));
+    flash_ops_snapshot(&before);
+
+    for (uint32_t address = pattern->start; address < pattern->end;
+         address += pattern->fragment_size) {
+        uint32_t length = MIN(pattern->fragment_size, pattern->end - address);
+        for (uint32_t i = 0; i < repeat; i++) {
+            bench_call(pattern, op, address, length, res);
+        }
+    }
+
+    flash_ops_snapshot(&after);
+    flash_ops_delta(&res->ops, &before, &after);
+}
+
+static void print_header(
+    void)
+{
+    printf("%-10s %-5s %8s %10s %8s %8s %8s %10s %10s %6s\n",
+        "pattern", "op", "bytes", "B/s", "rd/KiB", "wr/KiB", "er/KiB",
+        "max call", "max done", "err");
+}
+
+static void print_result(
+    const char *name,
+    const char *op,
+    const struct bench_result *res)
+{
+    uint64_t bytes_per_s = res->total_us ?
+                           ((uint64_t) res->bytes * USEC_PER_SEC) / res->total_us : 0;
+    /* Fixed point with two decimals */
+    uint32_t kib_x100 = MAX(1, (res->bytes * 100) / 1024);
+
+    printf("%-10s %-5s %8u %10llu %5u.%02u %5u.%02u %5u.%02u %8lluus %8lluus %6u\n",
+        name,
+        op,
+        res->bytes,
+        (unsigned long long) bytes_per_s,
+        (res->ops.reads * 10000 / kib_x100) / 100,
+        (res->ops.reads * 10000 / kib_x100) % 100,
+        (res->ops.writes * 10000 / kib_x100) / 100,
+        (res->ops.writes * 10000 / kib_x100) % 100,
+        (res->ops.erases * 10000 / kib_x100) / 100,
+        (res->ops.erases * 10000 / kib_x100) % 100,
+        (unsigned long long) res->max_call_us,
+        (unsigned long long) res->max_done_us,
+        res->mismatches);
+}
+
+int main(
+    void)
+{
+    /*
+     * Fragment sizes that are not a divisor of the page size make
+     * fragments straddle the page boundaries the driver special-cases.
+     * The mira-hole fragments cover the Mira header partially.
+     */
+    const struct bench_pattern patterns[] = {
+        {
+            .name = "sequential",
+            .start = FLASH_PAGE_SIZE,
+            .end = FLASH_PAGE_SIZE + CONFIG_FOTA_BENCH_IMAGE_SIZE,
+            .fragment_size = CONFIG_FOTA_BENCH_FRAGMENT_SIZE
+        },
+        {
+            .name = "header",
+            .start = 0,
+            .end = 2 * FLASH_PAGE_SIZE,
+            .fragment_size = 96
+        },
+        {
+            .name = "trailer",
+            .start = SWAP_SIZE - 2 * FLASH_PAGE_SIZE,
+            .end = SWAP_SIZE,
+            .fragment_size = 96
+        },
+        {
+            .name = "mira-hole",
+            .start = MIRA_HEADER_LOCATION - 64,
+            .end = MCU_BOOT_HEADER_LOCATION + 64,
+            .fragment_size = 40
+        },
+    };
+    struct bench_result res;
+
+    BUILD_ASSERT(CONFIG_FOTA_BENCH_FRAGMENT_SIZE <= MAX_FRAGMENT_SIZE);
+    BUILD_ASSERT(FLASH_PAGE_SIZE + CONFIG_FOTA_BENCH_IMAGE_SIZE
+        <= SWAP_SIZE - FLASH_PAGE_SIZE);
+
+    printf("-------------FOTA driver benchmark-------------\n");
+    printf("Slot size: %u, sequential fragment size: %u\n",
+        (uint32_t) SWAP_SIZE, CONFIG_FOTA_BENCH_FRAGMENT_SIZE);
+
+    fota_driver_set_custom_driver();
+    mira_fota_init();
+    drv = mira_sim_fota_get_driver();
+
+    print_header();
+    for (size_t i = 0; i < ARRAY_SIZE(patterns); i++) {
+        bench_erase(&res);
+        print_result(patterns[i].name, "erase", &res);
+        bench_run(&patterns[i], BENCH_OP_WRITE, &res);
+        print_result(patterns[i].name, "write", &res);
+        bench_run(&patterns[i], BENCH_OP_READ, &res);
+        print_result(patterns[i].name, "read", &res);
+        bench_run(&patterns[i], BENCH_OP_RELAY, &res);
+        print_result(patterns[i].name, "relay", &res);
+    }
+
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+    struct fota_write_queue_stats stats;
+    fota_write_queue_get_stats(&stats);
+    printf("Write queue: %u writes, max depth %u, %u held, %u rejected\n",
+        stats.submitted,
+        stats.max_depth,
+        stats.held,
+        stats.rejected);
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+    struct fota_write_combine_stats combine_stats;
+    fota_write_combine_get_stats(&combine_stats);
+    printf("Write combining: %u fragments, %u page, %u partial, %u direct\n",
+        combine_stats.fragments,
+        combine_stats.page_flushes,
+        combine_stats.partial_flushes,
+        combine_stats.direct_writes);
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    struct fota_read_cache_stats cache_stats;
+    fota_read_cache_get_stats(&cache_stats);
+    printf("Read cache: %u hits, %u misses, %u read ahead, %u invalidated\n",
+        cache_stats.hits,
+        cache_stats.misses,
+        cache_stats.readahead,
+        cache_stats.invalidations);
+#endif
+
+    printf("-------------FOTA driver benchmark done-------------\n");
+    return 0;
+}
@@ -1,25 +1,127 @@
 #!/usr/bin/env python3
 
-import os
 import re
-import sys
+import struct
+import zlib
 import argparse
-from intelhex import IntelHex
+
+# Layout of the config_area partition, see src/node_config/node_config.h
+CONFIG_MAGIC = b"MZCF"
+CONFIG_VERSION = 1
+CONFIG_HEADER_SIZE = 12
+
+MODES = {"root": 1, "root_no_reconnect": 2, "leaf": 3, "mesh": 4}
+RATES = {"fast": 0, "mid": 1, "slow": 2}
+
+
+def parse_int(value, bits):
+    number = int(value, 0)
+    if not 0 <= number < 1 << bits:
+        raise ValueError("%s does not fit in %u bits" % (value, bits))
+    return number
+
+
+def parse_choice(choices):
+    def parse(value):
+        if value in choices:
+            return choices[value]
+        if value.isdigit() and int(value) in choices.values():
+            return int(value)
+        raise ValueError("expected one of %s" % ", ".join(choices))
+    return parse
+
+
+def parse_key(value):
+    key = bytes.fromhex(value)
+    if len(key) != 16:
+        raise ValueError("expected 32 hex digits")
+    return key
+
+
+# Name: (type, encode, decode)
+FIELDS = {
+    "mode": (1, parse_choice(MODES), "<B"),
+    "pan_id": (2, lambda v: parse_int(v, 32), "<I"),
+    "key": (3, parse_key, None),
+    "rate": (4, parse_choice(RATES), "<B"),
+    "antenna": (5, lambda v: parse_int(v, 8), "<B"),
+    "udp_port": (6, lambda v: parse_int(v, 16), "<H"),
+    "send_interval_ms": (7, lambda v: parse_int(v, 32), "<I"),
+}
+
 
 def read_file(file):
-    data = bytearray()
+    """Fields of a config file, as name = value lines.
+
+    A file holding only the network mode as a number, the older format,
+    is read as "mode = <number>".
+    """
+    values = {}
 
     text = file.read()
 
-    rm_comments = re.compile("^#.*$")
-    for line in text.split("\n"):
-        line = rm_comments.sub("", line)
-        if line != "":
-            data.extend(line.encode("utf-8"))
-            data.extend(b"\n")
+    rm_comments = re.compile("#.*$")
+    for number, line in enumerate(text.split("\n"), 1):
+        line = rm_comments.sub("", line).strip()
+        if line == "":
+            continue
+        if "=" in line:
+            name, value = (part.strip() for part in line.split("=", 1))
+        elif not values and line.isdigit():
+            name, value = "mode", line
+        else:
+            raise ValueError("line %u: expected name = value" % number)
+        if name not in FIELDS:
+            raise ValueError("line %u: unknown field %s" % (number, name))
+        if name in values:
+            raise ValueError("line %u: %s set twice" % (number, name))
+        try:
+            values[name] = FIELDS[name][1](value)
+        except ValueError as e:
+            raise ValueError("line %u: %s: %s" % (number, name, e))
+    return values
+
+
+def encode(values):
+    fields = bytearray()
+    for name, value in values.items():
+        field_type, _, fmt = FIELDS[name]
+        data = value if fmt is None else struct.pack(fmt, value)
+        fields += struct.pack("<BB", field_type, len(data)) + data
+    header = CONFIG_MAGIC + struct.pack(
+        "<BBHI", CONFIG_VERSION, 0, len(fields), zlib.crc32(fields)
+    )
+    return header + fields
+
+
+def decode(data):
+    """Fields of an encoded config, checked as the firmware does"""
+    if data[:4] != CONFIG_MAGIC:
+        raise ValueError("bad magic")
+    if len(data) < CONFIG_HEADER_SIZE:
+        raise ValueError("truncated header")
+    version, _, length, crc = struct.unpack_from("<BBHI", data, 4)
+    if version != CONFIG_VERSION:
+        raise ValueError("unsupported version %u" % version)
+    fields = data[CONFIG_HEADER_SIZE:CONFIG_HEADER_SIZE + length]
+    if len(fields) != length:
+        raise ValueError("truncated fields")
+    if zlib.crc32(fields) != crc:
+        raise ValueError("bad CRC")
+    names = {field[0]: (name, field[2]) for name, field in FIELDS.items()}
+    values = {}
+    pos = 0
+    while pos < length:
+        if length - pos < 2 or length - pos - 2 < fields[pos + 1]:
+            raise ValueError("field at %u overruns the config" % pos)
+        field_type, field_length = fields[pos], fields[pos + 1]
+        value = fields[pos + 2:pos + 2 + field_length]
+        if field_type in names:
+            name, fmt = names[field_type]
+            values[name] = bytes(value) if fmt is None else struct.unpack(fmt, value)[0]
+        pos += 2 + field_length
+    return values
 
-    data.extend([0])
-    return data
 
 def add_padding(data, length):
     padded = data + bytearray([0xFF] * length)
@@ -28,12 +130,15 @@ def add_padding(data, length):
 
 if __name__ == "__main__":
 
+    # Only needed for the output, tests/config2hex imports this module without it
+    from intelhex import IntelHex
+
     class ArgHexInt(argparse.Action):
         def __call__(self, parser, namespace, values, option_string=None):
             setattr(namespace, self.dest, int(values, 0))
 
     parser = argparse.ArgumentParser(
-        description="pack a command sequence file to a hex file for flashing"
+        description="pack a node configuration file to a hex file for flashing"
     )
     parser.add_argument(
         "-f",
@@ -64,12 +169,32 @@ if __name__ == "__main__":
         required=True,
         action=ArgHexInt
     )
+    parser.add_argument(
+        "-b",
+        "--binary",
+        action="store_true",
+        help="write a binary image of the flash from address 0 instead, "
+        "for the native_sim flash simulator",
+    )
 
     args = parser.parse_args()
 
-    data_to_write = add_padding(read_file(args.infile), args.length)
+    try:
+        values = read_file(args.infile)
+    except ValueError as e:
+        parser.error("%s: %s" % (args.infile.name, e))
+    config = encode(values)
+    if len(config) > args.length:
+        parser.error("config of %u bytes does not fit in %u bytes" % (len(config), args.length))
+    if decode(config) != values:
+        raise SystemExit("verification failed")
+
+    data_to_write = add_padding(config, args.length)
 
     ih = IntelHex()
     ih.frombytes(data_to_write, args.address)
 
-    ih.write_hex_file(args.outfile, eolstyle="CRLF")
+    if args.binary:
+        ih.tobinfile(args.outfile.buffer, start=0)
+    else:
+        ih.write_hex_file(args.outfile, eolstyle="CRLF")
@@ -0,0 +1,329 @@
+#!/usr/bin/env python3
+
+import struct
+import argparse
+
+# Container layout, see src/fota_driver/fota_decompress.h
+MCUBOOT_IMAGE_MAGIC = 0x96F3B83D
+MCUBOOT_IMAGE_F_NON_BOOTABLE = 0x00000010
+MCUBOOT_HEADER_SIZE = 32
+COMPRESSED_MAGIC = b"MZC1"
+COMPRESSED_VERSION = 1
+COMPRESSED_HEADER_SIZE = 16
+COMPRESSED_FLAG_DELTA = 0x01
+
+# MCUboot TLV area, holding the SHA256 a delta image is checked against
+MCUBOOT_TLV_INFO_MAGIC = 0x6907
+MCUBOOT_TLV_PROT_INFO_MAGIC = 0x6908
+MCUBOOT_TLV_SHA256 = 0x10
+
+# Bytes that must match exactly before a base region is used for a diff
+DIFF_BLOCK = 8
+# Mismatching bytes tolerated past the best end of a diff region
+DIFF_SLACK = 32
+
+# Candidates checked per position when searching for a match
+MAX_CHAIN = 64
+
+
+class BitWriter:
+    def __init__(self):
+        self.data = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value, bits):
+        self.acc = (self.acc << bits) | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.data.append((self.acc >> self.count) & 0xFF)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count > 0:
+            self.data.append((self.acc << (8 - self.count)) & 0xFF)
+            self.count = 0
+        return bytes(self.data)
+
+
+def compress(data, window_bits, lookahead_bits):
+    window = 1 << window_bits
+    max_length = 1 << lookahead_bits
+    # A back-reference is only emitted when it is shorter than literals
+    min_length = (1 + window_bits + lookahead_bits) // 9 + 1
+
+    out = BitWriter()
+    chains = {}
+    pos = 0
+    while pos < len(data):
+        best_length = 0
+        best_distance = 0
+        key = data[pos:pos + 2]
+        candidates = chains.get(key, [])
+        limit = min(max_length, len(data) - pos)
+        for candidate in reversed(candidates[-MAX_CHAIN:]):
+            distance = pos - candidate
+            if distance > window:
+                break
+            length = 0
+            while length < limit and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_distance = distance
+                if length == limit:
+                    break
+
+        if best_length >= min_length:
+            out.write(0, 1)
+            out.write(best_distance - 1, window_bits)
+            out.write(best_length - 1, lookahead_bits)
+            step = best_length
+        else:
+            out.write(1, 1)
+            out.write(data[pos], 8)
+            step = 1
+
+        for i in range(pos, min(pos + step, len(data) - 1)):
+            chain = chains.setdefault(data[i:i + 2], [])
+            chain.append(i)
+            if len(chain) > 2 * MAX_CHAIN:
+                del chain[:MAX_CHAIN]
+        pos += step
+    return out.finish()
+
+
+def decompress(stream, image_size, window_bits, lookahead_bits):
+    out = bytearray()
+    acc = 0
+    count = 0
+    state = "tag"
+    distance = 0
+    needed = {"tag": 1, "literal": 8, "distance": window_bits, "length": lookahead_bits}
+    for byte in stream:
+        acc = (acc << 8) | byte
+        count += 8
+        while len(out) < image_size and count >= needed[state]:
+            count -= needed[state]
+            value = (acc >> count) & ((1 << needed[state]) - 1)
+            if state == "tag":
+                state = "literal" if value else "distance"
+            elif state == "literal":
+                out.append(value)
+                state = "tag"
+            elif state == "distance":
+                distance = value + 1
+                state = "length"
+            else:
+                if distance > len(out):
+                    raise ValueError("back-reference before start of image")
+                for _ in range(value + 1):
+                    out.append(out[-distance])
+                state = "tag"
+        acc &= (1 << count) - 1
+    return bytes(out[:image_size])
+
+
+def image_hash(image):
+    """Return the SHA256 TLV of an MCUboot image and the size up to its TLV end"""
+    magic, _, hdr_size, protected_size, img_size = struct.unpack_from("<IIHHI", image)
+    if magic != MCUBOOT_IMAGE_MAGIC:
+        raise ValueError("not an MCUboot image")
+    offset = hdr_size + img_size
+    if protected_size:
+        if struct.unpack_from("<H", image, offset)[0] != MCUBOOT_TLV_PROT_INFO_MAGIC:
+            raise ValueError("bad protected TLV area")
+        offset += protected_size
+    info_magic, total = struct.unpack_from("<HH", image, offset)
+    if info_magic != MCUBOOT_TLV_INFO_MAGIC:
+        raise ValueError("bad TLV area")
+    end = offset + total
+    offset += 4
+    while offset + 4 <= end:
+        tlv_type, length = struct.unpack_from("<HH", image, offset)
+        offset += 4
+        if tlv_type == MCUBOOT_TLV_SHA256 and length == 32:
+            return image[offset:offset + 32], end
+        offset += length
+    raise ValueError("no SHA256 TLV")
+
+
+def extend_match(base, base_pos, target, target_pos):
+    """Length of the region where base and target mostly agree, as in bsdiff"""
+    limit = min(len(base) - base_pos, len(target) - target_pos)
+    score = 0
+    best_score = 0
+    best_length = 0
+    for i in range(limit):
+        score += 1 if base[base_pos + i] == target[target_pos + i] else -1
+        if score > best_score:
+            best_score = score
+            best_length = i + 1
+        elif best_score - score > DIFF_SLACK:
+            break
+    return best_length
+
+
+def diff(base, target):
+    """Patch records turning base into target, see src/fota_driver/fota_delta.h"""
+    index = {}
+    for i in range(len(base) - DIFF_BLOCK + 1):
+        index.setdefault(base[i:i + DIFF_BLOCK], i)
+
+    patch = bytearray()
+    # Diff region waiting for the extra data following it
+    diff_target, diff_base, diff_length = 0, 0, 0
+    extra_start = 0
+    pos = 0
+    while pos < len(target):
+        block = target[pos:pos + DIFF_BLOCK]
+        match = pos + diff_base - diff_target
+        if match < 0 or base[match:match + DIFF_BLOCK] != block or len(block) < DIFF_BLOCK:
+            match = index.get(block)
+        if match is None:
+            pos += 1
+            continue
+        length = extend_match(base, match, target, pos)
+        if length == 0:
+            pos += 1
+            continue
+        patch += record(base, target, diff_target, diff_base, diff_length,
+                        extra_start, pos, match)
+        diff_target, diff_base, diff_length = pos, match, length
+        pos += length
+        extra_start = pos
+    patch += record(base, target, diff_target, diff_base, diff_length,
+                    extra_start, len(target), diff_base + diff_length)
+    return bytes(patch)
+
+
+def record(base, target, diff_target, diff_base, diff_length, extra_start, extra_end, next_base):
+    seek = next_base - (diff_base + diff_length)
+    data = bytearray(struct.pack("<IIi", diff_length, extra_end - extra_start, seek))
+    for i in range(diff_length):
+        data.append((target[diff_target + i] - base[diff_base + i]) & 0xFF)
+    data += target[extra_start:extra_end]
+    return data
+
+
+def apply_patch(base, patch):
+    out = bytearray()
+    base_pos = 0
+    pos = 0
+    while pos < len(patch):
+        diff_length, extra_length, seek = struct.unpack_from("<IIi", patch, pos)
+        pos += 12
+        for i in range(diff_length):
+            out.append((base[base_pos + i] + patch[pos + i]) & 0xFF)
+        pos += diff_length
+        base_pos += diff_length
+        out += patch[pos:pos + extra_length]
+        pos += extra_length
+        base_pos += seek
+    return bytes(out)
+
+
+def pack(image, window_bits, lookahead_bits, base=None):
+    flags = 0
+    delta_header = b""
+    payload = image
+    if base is not None:
+        base_hash, base_size = image_hash(base)
+        payload = diff(base[:base_size], image)
+        flags |= COMPRESSED_FLAG_DELTA
+        delta_header = struct.pack("<II", len(image), base_size) + base_hash
+    stream = compress(payload, window_bits, lookahead_bits)
+    container_size = COMPRESSED_HEADER_SIZE + len(delta_header) + len(stream)
+    mcuboot_header = struct.pack(
+        "<IIHHIIBBHI",
+        MCUBOOT_IMAGE_MAGIC,
+        0,  # load address
+        MCUBOOT_HEADER_SIZE,
+        0,  # protected TLV size
+        container_size,
+        MCUBOOT_IMAGE_F_NON_BOOTABLE,
+        0, 0, 0, 0,  # version
+    )
+    mcuboot_header += bytes(MCUBOOT_HEADER_SIZE - len(mcuboot_header))
+    header = COMPRESSED_MAGIC + struct.pack(
+        "<BBBBII",
+        COMPRESSED_VERSION,
+        window_bits,
+        lookahead_bits,
+        flags,
+        len(payload),
+        len(stream),
+    )
+    return mcuboot_header + header + delta_header + stream, payload, stream
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(
+        description="compress a signed MCUboot image, or the delta to a previous image, "
+        "for MiraMesh FOTA distribution"
+    )
+    parser.add_argument(
+        "-i",
+        "--image-file",
+        dest="infile",
+        required=True,
+        type=argparse.FileType("rb"),
+    )
+    parser.add_argument(
+        "-o",
+        "--output-file",
+        dest="outfile",
+        required=True,
+        type=argparse.FileType("wb"),
+    )
+    parser.add_argument(
+        "-w",
+        "--window-bits",
+        dest="window_bits",
+        type=int,
+        default=10,
+        help="log2 of the window, at most CONFIG_MIRA_FOTA_COMPRESSED_WINDOW_BITS",
+    )
+    parser.add_argument(
+        "-l",
+        "--lookahead-bits",
+        dest="lookahead_bits",
+        type=int,
+        help="log2 of the longest match, default 4, or 7 for delta images",
+    )
+    parser.add_argument(
+        "-b",
+        "--base-file",
+        dest="basefile",
+        type=argparse.FileType("rb"),
+        help="signed image running on the devices, to create a delta image against",
+    )
+    parser.add_argument(
+        "--verify",
+        action="store_true",
+        help="expand the result again and compare it with the image",
+    )
+
+    args = parser.parse_args()
+    if args.lookahead_bits is None:
+        args.lookahead_bits = 7 if args.basefile else 4
+    if not 4 <= args.window_bits <= 15 or not 1 <= args.lookahead_bits < args.window_bits:
+        parser.error("unsupported window or lookahead size")
+
+    image = args.infile.read()
+    base = args.basefile.read() if args.basefile else None
+    container, payload, stream = pack(image, args.window_bits, args.lookahead_bits, base)
+
+    if args.verify:
+        expanded = decompress(stream, len(payload), args.window_bits, args.lookahead_bits)
+        if base is not None:
+            expanded = apply_patch(base, expanded)
+        if expanded != image:
+            raise SystemExit("verification failed")
+
+    args.outfile.write(container)
+    print(
+        "%u -> %u bytes (%.1f%% smaller)"
+        % (len(image), len(container), 100.0 * (1 - len(container) / len(image)))
+    )
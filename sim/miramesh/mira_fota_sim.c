@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <miramesh.h>
+#include "mira_sim.h"
+
+static mira_fota_driver_t fota_driver;
+static bool fota_driver_set = false;
+static uint16_t fota_write_slot_id;
+
+/* Same layout as mira_fota_header_t, padded to MIRA_FOTA_HEADER_SIZE */
+static uint8_t fota_header_buf[MIRA_FOTA_HEADER_SIZE];
+
+void mira_fota_set_driver(
+    const mira_fota_driver_t *driver)
+{
+    fota_driver = *driver;
+    fota_driver_set = true;
+}
+
+const mira_fota_driver_t *mira_sim_fota_get_driver(
+    void)
+{
+    return fota_driver_set ? &fota_driver : NULL;
+}
+
+int mira_fota_init(
+    void)
+{
+    if (!fota_driver_set) {
+        return MIRA_ERROR_NOT_INITIALIZED;
+    }
+    if (fota_driver.init != NULL) {
+        fota_driver.init();
+    }
+    return MIRA_SUCCESS;
+}
+
+mira_bool_t mira_fota_is_valid(
+    uint16_t slot_id)
+{
+    return false;
+}
+
+int mira_fota_force_request(
+    void)
+{
+    return MIRA_SUCCESS;
+}
+
+static void fota_header_written(
+    void *storage)
+{
+}
+
+mira_status_t mira_fota_write_start(
+    uint16_t slot_id)
+{
+    fota_write_slot_id = slot_id;
+    memset(fota_header_buf, 0xff, sizeof(fota_header_buf));
+    return MIRA_SUCCESS;
+}
+
+mira_status_t mira_fota_write_header(
+    uint32_t size,
+    uint32_t checksum,
+    uint8_t type,
+    uint8_t flags,
+    uint16_t version)
+{
+    mira_fota_header_t header = {
+        .size = size,
+        .checksum = checksum,
+        .version = version,
+        .type = type,
+        .flags = flags
+    };
+
+    memcpy(fota_header_buf, &header, sizeof(header));
+    return MIRA_SUCCESS;
+}
+
+mira_status_t mira_fota_write_end(
+    void)
+{
+    if (!fota_driver_set || fota_driver.write_header == NULL) {
+        return MIRA_ERROR_NOT_INITIALIZED;
+    }
+    if (fota_driver.write_header(fota_write_slot_id,
+        fota_header_buf,
+        fota_header_written,
+        NULL) != 0) {
+        return MIRA_ERROR_INVALID_VALUE;
+    }
+    return MIRA_SUCCESS;
+}
+
+/* Plain CRC-32 (IEEE), only needs to be deterministic on the host */
+void mira_crc_init(
+    mira_crc_ctx_t *ctx)
+{
+    ctx->crc = 0xffffffff;
+}
+
+void mira_crc_update(
+    mira_crc_ctx_t *ctx,
+    const void *data,
+    uint32_t length)
+{
+    const uint8_t *bytes = data;
+    uint32_t crc = ctx->crc;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    ctx->crc = crc;
+}
+
+void mira_crc_get(
+    mira_crc_ctx_t *ctx,
+    uint32_t *crc)
+{
+    *crc = ~ctx->crc;
+}
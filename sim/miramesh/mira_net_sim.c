@@ -0,0 +1,558 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Simulated MiraMesh network for native_sim. The application runs as
+ * one node of a tree shaped network, the other nodes only exist in the
+ * simulation. Packets are delayed and dropped per hop on their way
+ * through the tree, and delivered to the application's UDP callbacks on
+ * a work queue of their own.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "soc.h"
+
+#include <miramesh.h>
+#include "mira_sim.h"
+
+/* Upper limit of CONFIG_MIRA_SIM_NODES and --mira_nodes */
+#define MAX_NODES 1024
+
+#define EPHEMERAL_PORT 49152
+
+struct mira_net_udp_connection {
+    bool used;
+    uint16_t local_port;
+    mira_net_udp_callback_t callback;
+    void *storage;
+};
+
+struct sim_packet {
+    struct k_work_delayable work;
+    uint16_t source_node;
+    uint16_t destination_node;
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint8_t hop_count;
+    uint16_t length;
+    uint8_t data[CONFIG_MIRA_SIM_MAX_PAYLOAD_SIZE];
+};
+
+#define PACKET_BLOCK_SIZE ROUND_UP(sizeof(struct sim_packet), 8)
+
+K_MEM_SLAB_DEFINE_STATIC(packet_slab, PACKET_BLOCK_SIZE, CONFIG_MIRA_SIM_QUEUE_SIZE, 8);
+K_THREAD_STACK_DEFINE(sim_stack, CONFIG_MIRA_SIM_STACK_SIZE);
+static struct k_work_q sim_work_q;
+
+/* Network parameters, from Kconfig or the command line */
+static uint32_t nodes = CONFIG_MIRA_SIM_NODES;
+static uint32_t fanout = CONFIG_MIRA_SIM_FANOUT;
+static uint32_t node_option = CONFIG_MIRA_SIM_NODE;
+static uint32_t hop_latency = CONFIG_MIRA_SIM_HOP_LATENCY_MS;
+static uint32_t hop_jitter = CONFIG_MIRA_SIM_HOP_JITTER_MS;
+static uint32_t hop_loss = CONFIG_MIRA_SIM_HOP_LOSS_PERMILLE;
+static uint32_t join_delay = CONFIG_MIRA_SIM_JOIN_DELAY_MS;
+static uint32_t traffic_interval = CONFIG_MIRA_SIM_TRAFFIC_INTERVAL_MS;
+static uint32_t seed = 1;
+
+static struct k_spinlock sim_lock;
+static struct mira_sim_net_stats stats;
+static uint32_t random_state;
+
+static bool initialized;
+static uint32_t local_node;
+/* Latency multiplier of the configured rate */
+static uint32_t rate_factor = 1;
+static volatile mira_net_state_t local_state = MIRA_NET_STATE_NOT_ASSOCIATED;
+static void (*state_callback)(mira_net_state_t net_state);
+static struct k_work_delayable state_work;
+
+static struct mira_net_udp_connection connections[CONFIG_MIRA_SIM_CONNECTIONS];
+static uint16_t next_ephemeral_port = EPHEMERAL_PORT;
+
+static struct k_work_delayable traffic_work;
+static int64_t traffic_next[MAX_NODES];
+
+static void sim_options(
+    void)
+{
+    static struct args_struct_t options[] = {
+        { .option = "mira_nodes", .name = "count", .type = 'u', .dest = &nodes,
+          .descript = "Nodes in the simulated network, root included" },
+        { .option = "mira_fanout", .name = "count", .type = 'u', .dest = &fanout,
+          .descript = "Children per node" },
+        { .option = "mira_node", .name = "index", .type = 'u', .dest = &node_option,
+          .descript = "Node the application runs as when not the root, 0 for the last" },
+        { .option = "mira_latency", .name = "ms", .type = 'u', .dest = &hop_latency,
+          .descript = "Latency per hop" },
+        { .option = "mira_jitter", .name = "ms", .type = 'u', .dest = &hop_jitter,
+          .descript = "Random extra latency per hop, at most" },
+        { .option = "mira_loss", .name = "permille", .type = 'u', .dest = &hop_loss,
+          .descript = "Packets lost per hop, per mille" },
+        { .option = "mira_join_delay", .name = "ms", .type = 'u', .dest = &join_delay,
+          .descript = "Time to join, per hop from the root" },
+        { .option = "mira_interval", .name = "ms", .type = 'u', .dest = &traffic_interval,
+          .descript = "Time between packets from each simulated node, 0 for none" },
+        { .option = "mira_seed", .name = "value", .type = 'u', .dest = &seed,
+          .descript = "Seed of the latency and loss randomness" },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(sim_options, PRE_BOOT_1, 1);
+
+static void print_stats(
+    void)
+{
+    if (initialized) {
+        printk("MiraMesh sim: %u sent, %u lost, %u queue full, %u delivered, %u without listener\n",
+            stats.sent,
+            stats.lost,
+            stats.queue_full,
+            stats.delivered,
+            stats.no_listener);
+    }
+}
+
+NATIVE_TASK(print_stats, ON_EXIT_PRE, 1);
+
+/* xorshift32, reproducible for a given --mira_seed */
+static uint32_t random_next(
+    void)
+{
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+}
+
+static uint32_t parent_of(
+    uint32_t node)
+{
+    return (node - 1) / fanout;
+}
+
+static uint32_t depth_of(
+    uint32_t node)
+{
+    uint32_t depth = 0;
+    while (node != 0) {
+        node = parent_of(node);
+        depth++;
+    }
+    return depth;
+}
+
+/* Hops between two nodes, up to their closest common parent and down */
+static uint32_t hops_between(
+    uint32_t a,
+    uint32_t b)
+{
+    uint32_t depth_a = depth_of(a);
+    uint32_t depth_b = depth_of(b);
+    uint32_t hops = 0;
+
+    for (; depth_a > depth_b; depth_a--, hops++) {
+        a = parent_of(a);
+    }
+    for (; depth_b > depth_a; depth_b--, hops++) {
+        b = parent_of(b);
+    }
+    while (a != b) {
+        a = parent_of(a);
+        b = parent_of(b);
+        hops += 2;
+    }
+    return hops;
+}
+
+/* Node n has the address fd00::n+1 */
+static void node_address(
+    uint32_t node,
+    mira_net_address_t *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->u8[0] = 0xfd;
+    sys_put_be16(node + 1, &address->u8[14]);
+}
+
+static int node_of(
+    const mira_net_address_t *address)
+{
+    mira_net_address_t expected;
+    uint32_t node = sys_get_be16(&address->u8[14]) - 1;
+
+    if (node >= nodes) {
+        return -1;
+    }
+    node_address(node, &expected);
+    return memcmp(address, &expected, sizeof(expected)) == 0 ? node : -1;
+}
+
+static struct mira_net_udp_connection *connection_on_port(
+    uint16_t port)
+{
+    for (int i = 0; i < CONFIG_MIRA_SIM_CONNECTIONS; i++) {
+        if (connections[i].used && connections[i].local_port == port) {
+            return &connections[i];
+        }
+    }
+    return NULL;
+}
+
+static void deliver(
+    struct k_work *work);
+
+/*
+ * Send a packet through the network. Lost packets are only counted, as
+ * the sender would not know about them either.
+ */
+static mira_status_t transmit(
+    uint32_t source_node,
+    uint16_t source_port,
+    uint32_t destination_node,
+    uint16_t destination_port,
+    const void *data,
+    uint16_t length)
+{
+    uint32_t hops = hops_between(source_node, destination_node);
+    uint32_t delay = 0;
+    bool lost = false;
+    struct sim_packet *packet;
+
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    stats.sent++;
+    for (uint32_t i = 0; i < hops; i++) {
+        lost |= random_next() % 1000 < hop_loss;
+        delay += (hop_latency + random_next() % (hop_jitter + 1)) * rate_factor;
+    }
+    if (lost) {
+        stats.lost++;
+    }
+    k_spin_unlock(&sim_lock, key);
+    if (lost) {
+        return MIRA_SUCCESS;
+    }
+
+    if (k_mem_slab_alloc(&packet_slab, (void **) &packet, K_NO_WAIT) != 0) {
+        key = k_spin_lock(&sim_lock);
+        stats.sent--;
+        stats.queue_full++;
+        k_spin_unlock(&sim_lock, key);
+        return MIRA_ERROR_NO_MEMORY;
+    }
+    packet->source_node = source_node;
+    packet->destination_node = destination_node;
+    packet->source_port = source_port;
+    packet->destination_port = destination_port;
+    packet->hop_count = MIN(hops, UINT8_MAX);
+    packet->length = length;
+    memcpy(packet->data, data, length);
+    k_work_init_delayable(&packet->work, deliver);
+    k_work_schedule_for_queue(&sim_work_q, &packet->work, K_MSEC(delay));
+    return MIRA_SUCCESS;
+}
+
+static void deliver(
+    struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct sim_packet *packet = CONTAINER_OF(dwork, struct sim_packet, work);
+    bool listened = true;
+
+    if (packet->destination_node == local_node) {
+        struct mira_net_udp_connection *connection =
+            connection_on_port(packet->destination_port);
+        if (connection != NULL && connection->callback != NULL) {
+            mira_net_address_t source;
+            mira_net_address_t destination;
+            node_address(packet->source_node, &source);
+            node_address(packet->destination_node, &destination);
+            mira_net_udp_callback_metadata_t metadata = {
+                .source_address = &source,
+                .source_port = packet->source_port,
+                .destination_address = &destination,
+                .destination_port = packet->destination_port,
+                .hop_count = packet->hop_count
+            };
+            connection->callback(connection, packet->data, packet->length, &metadata,
+                connection->storage);
+        } else {
+            listened = false;
+        }
+    } else if (packet->destination_node == 0
+               && packet->destination_port == CONFIG_MIRA_SIM_ECHO_PORT) {
+        transmit(0, packet->destination_port, packet->source_node,
+            packet->source_port, packet->data, packet->length);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    if (listened) {
+        stats.delivered++;
+    } else {
+        stats.no_listener++;
+    }
+    k_spin_unlock(&sim_lock, key);
+    k_mem_slab_free(&packet_slab, packet);
+}
+
+/* Hello messages of the simulated nodes to a root application */
+static void traffic_handler(
+    struct k_work *work)
+{
+    int64_t now = k_uptime_get();
+    int64_t earliest = INT64_MAX;
+    char message[32];
+
+    for (uint32_t node = 1; node < nodes; node++) {
+        if (traffic_next[node] <= now) {
+            int length = snprintf(message, sizeof(message), "Hello world from node %u", node);
+            transmit(node, EPHEMERAL_PORT, 0, CONFIG_MIRA_SIM_TRAFFIC_PORT, message, length);
+            traffic_next[node] += traffic_interval;
+        }
+        earliest = MIN(earliest, traffic_next[node]);
+    }
+    k_work_schedule_for_queue(&sim_work_q, &traffic_work, K_MSEC(MAX(earliest - now, 0)));
+}
+
+static void start_traffic(
+    void)
+{
+    if (traffic_interval == 0) {
+        return;
+    }
+    /* Each node starts sending when it has joined, spread over an interval */
+    for (uint32_t node = 1; node < nodes; node++) {
+        traffic_next[node] = depth_of(node) * join_delay
+                             + (uint64_t) node * traffic_interval / nodes;
+    }
+    k_work_init_delayable(&traffic_work, traffic_handler);
+    k_work_schedule_for_queue(&sim_work_q, &traffic_work, K_NO_WAIT);
+}
+
+static void state_handler(
+    struct k_work *work)
+{
+    if (local_state == MIRA_NET_STATE_NOT_ASSOCIATED && local_node != 0) {
+        local_state = MIRA_NET_STATE_ASSOCIATED;
+        k_work_schedule_for_queue(&sim_work_q, &state_work,
+            K_MSEC(depth_of(local_node) * join_delay / 2));
+    } else {
+        local_state = MIRA_NET_STATE_JOINED;
+    }
+    if (state_callback != NULL) {
+        state_callback(local_state);
+    }
+}
+
+/* Slower rates are modelled as proportionally longer hops */
+static uint32_t rate_factor_of(
+    mira_net_rate_t rate)
+{
+    switch (rate) {
+        case MIRA_NET_RATE_MID:
+            return 2;
+        case MIRA_NET_RATE_SLOW:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+mira_status_t mira_net_init(
+    const mira_net_config_t *config)
+{
+    if (initialized) {
+        return MIRA_ERROR_ALREADY_INITIALIZED;
+    }
+    rate_factor = rate_factor_of(config->rate);
+    nodes = CLAMP(nodes, 2, MAX_NODES);
+    fanout = MAX(fanout, 1);
+    random_state = seed != 0 ? seed : 1;
+
+    if (config->mode == MIRA_NET_MODE_ROOT || config->mode == MIRA_NET_MODE_ROOT_NO_RECONNECT) {
+        local_node = 0;
+    } else {
+        local_node = node_option == 0 || node_option >= nodes ? nodes - 1 : node_option;
+    }
+    printk("MiraMesh sim: %u nodes, running as node %u at depth %u\n",
+        nodes,
+        local_node,
+        depth_of(local_node));
+
+    k_work_queue_start(&sim_work_q, sim_stack, K_THREAD_STACK_SIZEOF(sim_stack),
+        CONFIG_MIRA_SIM_PRIORITY, NULL);
+    k_work_init_delayable(&state_work, state_handler);
+    k_work_schedule_for_queue(&sim_work_q, &state_work,
+        K_MSEC(depth_of(local_node) * join_delay / 2));
+    if (local_node == 0) {
+        start_traffic();
+    }
+    initialized = true;
+    return MIRA_SUCCESS;
+}
+
+void mira_net_register_net_state_cb(
+    void (*callback)(mira_net_state_t net_state))
+{
+    state_callback = callback;
+}
+
+mira_net_state_t mira_net_get_state(
+    void)
+{
+    return local_state;
+}
+
+mira_status_t mira_net_get_root_address(
+    mira_net_address_t *address)
+{
+    if (local_state != MIRA_NET_STATE_JOINED) {
+        return MIRA_ERROR_NOT_INITIALIZED;
+    }
+    node_address(0, address);
+    return MIRA_SUCCESS;
+}
+
+mira_status_t mira_net_get_parent_address(
+    mira_net_address_t *address)
+{
+    if (local_state != MIRA_NET_STATE_JOINED || local_node == 0) {
+        return MIRA_ERROR_NOT_INITIALIZED;
+    }
+    node_address(parent_of(local_node), address);
+    return MIRA_SUCCESS;
+}
+
+const char *mira_net_toolkit_format_address(
+    char *buffer,
+    const mira_net_address_t *address)
+{
+    int node = node_of(address);
+
+    if (node >= 0) {
+        snprintf(buffer, MIRA_NET_MAX_ADDRESS_STR_LEN, "fd00::%x", node + 1);
+        return buffer;
+    }
+    char *pos = buffer;
+    for (int i = 0; i < 16; i += 2) {
+        pos += sprintf(pos, i == 0 ? "%x" : ":%x", sys_get_be16(&address->u8[i]));
+    }
+    return buffer;
+}
+
+mira_net_udp_connection_t *mira_net_udp_connect(
+    const mira_net_address_t *address,
+    uint16_t port,
+    mira_net_udp_callback_t callback,
+    void *storage)
+{
+    for (int i = 0; i < CONFIG_MIRA_SIM_CONNECTIONS; i++) {
+        if (!connections[i].used) {
+            connections[i] = (struct mira_net_udp_connection) {
+                .used = true,
+                .local_port = next_ephemeral_port++,
+                .callback = callback,
+                .storage = storage
+            };
+            return &connections[i];
+        }
+    }
+    return NULL;
+}
+
+mira_status_t mira_net_udp_listen(
+    uint16_t port,
+    mira_net_udp_callback_t callback,
+    void *storage)
+{
+    if (connection_on_port(port) != NULL) {
+        return MIRA_ERROR_INVALID_VALUE;
+    }
+    for (int i = 0; i < CONFIG_MIRA_SIM_CONNECTIONS; i++) {
+        if (!connections[i].used) {
+            connections[i] = (struct mira_net_udp_connection) {
+                .used = true,
+                .local_port = port,
+                .callback = callback,
+                .storage = storage
+            };
+            return MIRA_SUCCESS;
+        }
+    }
+    return MIRA_ERROR_NO_MEMORY;
+}
+
+mira_status_t mira_net_udp_send_to(
+    mira_net_udp_connection_t *connection,
+    const mira_net_address_t *address,
+    uint16_t port,
+    const void *data,
+    uint16_t data_len)
+{
+    if (connection == NULL || data_len > CONFIG_MIRA_SIM_MAX_PAYLOAD_SIZE) {
+        return MIRA_ERROR_INVALID_VALUE;
+    }
+    if (local_state != MIRA_NET_STATE_JOINED) {
+        return MIRA_ERROR_NOT_INITIALIZED;
+    }
+    int node = node_of(address);
+    if (node < 0) {
+        return MIRA_ERROR_INVALID_VALUE;
+    }
+    return transmit(local_node, connection->local_port, node, port, data, data_len);
+}
+
+mira_status_t mira_sys_get_device_id(
+    mira_sys_device_id_t *id)
+{
+    /* Not known to be the root until mira_net_init */
+    uint32_t node = initialized ? local_node : node_option;
+
+    memset(id, 0, sizeof(*id));
+    id->u8[0] = 0x5e;
+    sys_put_be16(node, &id->u8[6]);
+    return MIRA_SUCCESS;
+}
+
+void mira_sim_net_get_stats(
+    struct mira_sim_net_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    *out = stats;
+    k_spin_unlock(&sim_lock, key);
+}
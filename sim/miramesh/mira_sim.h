@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef MIRA_SIM_H
+#define MIRA_SIM_H
+
+#include <miramesh.h>
+
+/**
+ * Get the FOTA driver registered with mira_fota_set_driver().
+ *
+ * Only available in the native_sim stand-in, lets host-side tools call
+ * the driver the same way the MiraMesh stack would.
+ */
+const mira_fota_driver_t *mira_sim_fota_get_driver(
+    void);
+
+struct mira_sim_net_stats {
+    /* Packets sent by any node, the application or simulated */
+    uint32_t sent;
+    /* Packets dropped on one of their hops */
+    uint32_t lost;
+    /* Sends refused because CONFIG_MIRA_SIM_QUEUE_SIZE were in flight */
+    uint32_t queue_full;
+    uint32_t delivered;
+    /* Packets to a port of the application nobody listened on */
+    uint32_t no_listener;
+};
+
+/**
+ * Get the packet counts of the simulated network, which are also
+ * printed when the simulation exits.
+ */
+void mira_sim_net_get_stats(
+    struct mira_sim_net_stats *stats);
+
+#endif /* MIRA_SIM_H */
@@ -0,0 +1,245 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Host-side stand-in for the parts of the libmira API used by this
+ * example. It is only meant for native_sim builds, where libmira is not
+ * available.
+ */
+
+#ifndef MIRAMESH_H
+#define MIRAMESH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef bool mira_bool_t;
+
+typedef enum {
+    MIRA_SUCCESS = 0,
+    MIRA_ERROR_NOT_INITIALIZED = -1,
+    MIRA_ERROR_INVALID_VALUE = -2,
+    MIRA_ERROR_ALREADY_INITIALIZED = -3,
+    MIRA_ERROR_NO_MEMORY = -4,
+    MIRA_ERROR_UNKNOWN = -5
+} mira_status_t;
+
+/* System */
+
+typedef struct {
+    uint8_t u8[8];
+} mira_sys_device_id_t;
+
+mira_status_t mira_sys_get_device_id(
+    mira_sys_device_id_t *id);
+
+/* Network */
+
+#define MIRA_NET_MAX_ADDRESS_STR_LEN 40
+
+typedef enum {
+    MIRA_NET_STATE_NOT_ASSOCIATED,
+    MIRA_NET_STATE_ASSOCIATED,
+    MIRA_NET_STATE_JOINED
+} mira_net_state_t;
+
+typedef enum {
+    MIRA_NET_MODE_MESH,
+    MIRA_NET_MODE_ROOT,
+    MIRA_NET_MODE_ROOT_NO_RECONNECT,
+    MIRA_NET_MODE_LEAF
+} mira_net_mode_t;
+
+typedef enum {
+    MIRA_NET_RATE_FAST,
+    MIRA_NET_RATE_MID,
+    MIRA_NET_RATE_SLOW
+} mira_net_rate_t;
+
+typedef struct {
+    uint32_t pan_id;
+    uint8_t key[16];
+    mira_net_mode_t mode;
+    mira_net_rate_t rate;
+    uint8_t antenna;
+    const char *prefix;
+} mira_net_config_t;
+
+typedef struct {
+    uint8_t u8[16];
+} mira_net_address_t;
+
+mira_status_t mira_net_init(
+    const mira_net_config_t *config);
+
+void mira_net_register_net_state_cb(
+    void (*callback)(mira_net_state_t net_state));
+
+mira_net_state_t mira_net_get_state(
+    void);
+
+mira_status_t mira_net_get_root_address(
+    mira_net_address_t *address);
+
+mira_status_t mira_net_get_parent_address(
+    mira_net_address_t *address);
+
+const char *mira_net_toolkit_format_address(
+    char *buffer,
+    const mira_net_address_t *address);
+
+/* UDP */
+
+typedef struct mira_net_udp_connection mira_net_udp_connection_t;
+
+typedef struct {
+    const mira_net_address_t *source_address;
+    uint16_t source_port;
+    const mira_net_address_t *destination_address;
+    uint16_t destination_port;
+    uint8_t hop_count;
+} mira_net_udp_callback_metadata_t;
+
+typedef void (*mira_net_udp_callback_t)(
+    mira_net_udp_connection_t *connection,
+    const void *data,
+    uint16_t data_len,
+    const mira_net_udp_callback_metadata_t *metadata,
+    void *storage);
+
+mira_net_udp_connection_t *mira_net_udp_connect(
+    const mira_net_address_t *address,
+    uint16_t port,
+    mira_net_udp_callback_t callback,
+    void *storage);
+
+mira_status_t mira_net_udp_listen(
+    uint16_t port,
+    mira_net_udp_callback_t callback,
+    void *storage);
+
+mira_status_t mira_net_udp_send_to(
+    mira_net_udp_connection_t *connection,
+    const mira_net_address_t *address,
+    uint16_t port,
+    const void *data,
+    uint16_t data_len);
+
+/* FOTA */
+
+#define MIRA_FOTA_HEADER_SIZE 32
+
+typedef struct {
+    uint32_t size;
+    uint32_t checksum;
+    uint16_t version;
+    uint8_t type;
+    uint8_t flags;
+} mira_fota_header_t;
+
+typedef struct {
+    void (*init)(
+        void);
+    int (*get_size)(
+        uint16_t slot_id,
+        uint32_t *size,
+        void (*done_callback)(void *storage),
+        void *storage);
+    int (*read)(
+        uint16_t slot_id,
+        void *data,
+        uint32_t address,
+        uint32_t length,
+        void (*done_callback)(void *storage),
+        void *storage);
+    int (*write)(
+        uint16_t slot_id,
+        const void *data,
+        uint32_t address,
+        uint32_t length,
+        void (*done_callback)(void *storage),
+        void *storage);
+    int (*erase)(
+        uint16_t slot_id,
+        void (*done_callback)(void *storage),
+        void *storage);
+    int (*read_header)(
+        uint16_t slot_id,
+        void *data,
+        void (*done_callback)(void *storage),
+        void *storage);
+    int (*write_header)(
+        uint16_t slot_id,
+        const void *data,
+        void (*done_callback)(void *storage),
+        void *storage);
+} mira_fota_driver_t;
+
+void mira_fota_set_driver(
+    const mira_fota_driver_t *driver);
+
+int mira_fota_init(
+    void);
+
+mira_bool_t mira_fota_is_valid(
+    uint16_t slot_id);
+
+int mira_fota_force_request(
+    void);
+
+mira_status_t mira_fota_write_start(
+    uint16_t slot_id);
+
+mira_status_t mira_fota_write_header(
+    uint32_t size,
+    uint32_t checksum,
+    uint8_t type,
+    uint8_t flags,
+    uint16_t version);
+
+mira_status_t mira_fota_write_end(
+    void);
+
+/* CRC */
+
+typedef struct {
+    uint32_t crc;
+} mira_crc_ctx_t;
+
+void mira_crc_init(
+    mira_crc_ctx_t *ctx);
+
+void mira_crc_update(
+    mira_crc_ctx_t *ctx,
+    const void *data,
+    uint32_t length);
+
+void mira_crc_get(
+    mira_crc_ctx_t *ctx,
+    uint32_t *crc);
+
+#endif /* MIRAMESH_H */
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+
+#include "boot_profile.h"
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_CONFIG] = "config",
+    [BOOT_PHASE_NET_INIT] = "net init",
+    [BOOT_PHASE_FOTA_INIT] = "fota init",
+    [BOOT_PHASE_BLE_INIT] = "ble init",
+    [BOOT_PHASE_JOIN] = "join",
+    [BOOT_PHASE_FIRST_PACKET] = "first packet",
+};
+
+/*
+ * Phases are timestamped from main, the init work queue and the mira
+ * network callback, but each phase only from one of them. The bits are
+ * set after the timestamps, for the report.
+ */
+static ATOMIC_DEFINE(started, BOOT_PHASE_COUNT);
+static ATOMIC_DEFINE(ended, BOOT_PHASE_COUNT);
+static int64_t start_ticks[BOOT_PHASE_COUNT];
+static int64_t end_ticks[BOOT_PHASE_COUNT];
+
+static void print_ms(
+    const char *label,
+    int64_t ticks)
+{
+    uint64_t us = k_ticks_to_us_floor64(ticks);
+
+    printf(" %s %5u.%03u ms", label,
+        (uint32_t) (us / USEC_PER_MSEC),
+        (uint32_t) (us % USEC_PER_MSEC));
+}
+
+static void boot_profile_report(
+    void)
+{
+    printf("Boot profile, from kernel start:\n");
+    for (int phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+        printf("  %-12s", phase_names[phase]);
+        if (!atomic_test_bit(started, phase)) {
+            printf(" not started\n");
+            continue;
+        }
+        print_ms("at", start_ticks[phase]);
+        if (atomic_test_bit(ended, phase)) {
+            print_ms("took", end_ticks[phase] - start_ticks[phase]);
+            printf("\n");
+        } else {
+            printf(" still running\n");
+        }
+    }
+}
+
+void boot_profile_start(
+    enum boot_phase phase)
+{
+    int64_t now = k_uptime_ticks();
+
+    if (atomic_test_bit(started, phase)) {
+        return;
+    }
+    start_ticks[phase] = now;
+    atomic_set_bit(started, phase);
+}
+
+void boot_profile_end(
+    enum boot_phase phase)
+{
+    int64_t now = k_uptime_ticks();
+
+    /* Only ends of a started phase count, and only the first */
+    if (!atomic_test_bit(started, phase) || atomic_test_bit(ended, phase)) {
+        return;
+    }
+    end_ticks[phase] = now;
+    atomic_set_bit(ended, phase);
+    if (phase == BOOT_PHASE_FIRST_PACKET) {
+        boot_profile_report();
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+/*
+ * Boot phase timestamps, relative to the start of the kernel. Phases may
+ * overlap, the BLE setup runs on a work queue of its own while the node
+ * joins the network. Only the first start and end of a phase are kept,
+ * so phases that run again later, like the join after a rate change, do
+ * not change the report.
+ *
+ * The report is printed when BOOT_PHASE_FIRST_PACKET ends, which is the
+ * first packet handed to the network on nodes and the first packet
+ * received on the root. Phases still running at that point are reported
+ * as such.
+ */
+enum boot_phase {
+    /* Reading the node configuration from flash */
+    BOOT_PHASE_CONFIG,
+    /* mira_net_init() */
+    BOOT_PHASE_NET_INIT,
+    /* Registering the FOTA driver and mira_fota_init() */
+    BOOT_PHASE_FOTA_INIT,
+    /* LEDs, buttons, BLE and mcumgr, on the init work queue */
+    BOOT_PHASE_BLE_INIT,
+    /* From mira_net_init() until the node is joined */
+    BOOT_PHASE_JOIN,
+    /* From the start of main() until the first packet */
+    BOOT_PHASE_FIRST_PACKET,
+    BOOT_PHASE_COUNT
+};
+
+#if CONFIG_BOOT_PROFILE
+/**
+ * Timestamp the start of a phase.
+ */
+void boot_profile_start(
+    enum boot_phase phase);
+
+/**
+ * Timestamp the end of a phase, and print the report when it is
+ * BOOT_PHASE_FIRST_PACKET.
+ */
+void boot_profile_end(
+    enum boot_phase phase);
+#else
+static inline void boot_profile_start(
+    enum boot_phase phase)
+{
+}
+
+static inline void boot_profile_end(
+    enum boot_phase phase)
+{
+}
+#endif /* CONFIG_BOOT_PROFILE */
+
+#endif /* BOOT_PROFILE_H */
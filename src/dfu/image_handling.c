@@ -30,11 +30,41 @@
 
 #include <zephyr/mgmt/mcumgr/mgmt/mgmt.h>
 #include <zephyr/mgmt/mcumgr/mgmt/callbacks.h>
+#include <zephyr/mgmt/mcumgr/mgmt/handlers.h>
+#include <zephyr/mgmt/mcumgr/smp/smp.h>
+#include <zcbor_encode.h>
+#if CONFIG_MIRA_FOTA_CRC_TRACK_UPLOAD
+#include <zephyr/mgmt/mcumgr/grp/img_mgmt/img_mgmt.h>
+#endif
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <string.h>
+#if CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
 
 #include "fota_driver.h"
 
+/*
+ * Post-processing of an image uploaded over BLE runs on its own work
+ * queue, so the SMP response is not held back by the flash work.
+ */
+K_THREAD_STACK_DEFINE(dfu_job_stack, CONFIG_MIRA_FOTA_DFU_JOB_STACK_SIZE);
+static struct k_work_q dfu_job_queue;
+static struct k_work dfu_job_work;
+
+static K_MUTEX_DEFINE(dfu_job_lock);
+static struct image_handling_job_status dfu_job_status = {
+    .state = IMAGE_HANDLING_JOB_IDLE
+};
+static int64_t dfu_job_pending_time;
+
 struct mgmt_callback dfu_done_cb;
 struct mgmt_callback block_reset_cb;
+#if CONFIG_MIRA_FOTA_CRC_TRACK_UPLOAD
+struct mgmt_callback dfu_chunk_cb;
+#endif
 
 enum mgmt_cb_return dfu_done_checker(
     uint32_t event,
@@ -45,15 +75,235 @@ enum mgmt_cb_return dfu_done_checker(
     void *data,
     size_t data_size)
 {
-    if (event == MGMT_EVT_OP_IMG_MGMT_DFU_PENDING) {
+    if (event == MGMT_EVT_OP_IMG_MGMT_DFU_STARTED) {
+        fota_driver_swap_written_externally();
+    } else if (event == MGMT_EVT_OP_IMG_MGMT_DFU_PENDING) {
         printf("Pending OK!\n");
-        fota_driver_copy_trailer_page();
-        fota_driver_copy_header_page();
-        fota_driver_write_new_header();
+        k_mutex_lock(&dfu_job_lock, K_FOREVER);
+        dfu_job_status.state = IMAGE_HANDLING_JOB_PENDING;
+        dfu_job_status.error = 0;
+        dfu_job_pending_time = k_uptime_get();
+        k_mutex_unlock(&dfu_job_lock);
+        k_work_submit_to_queue(&dfu_job_queue, &dfu_job_work);
+    }
+    return MGMT_CB_OK;
+}
+
+static void dfu_job_set_state(
+    enum image_handling_job_state state)
+{
+    k_mutex_lock(&dfu_job_lock, K_FOREVER);
+    dfu_job_status.state = state;
+    k_mutex_unlock(&dfu_job_lock);
+}
+
+static void dfu_job_handler(
+    struct k_work *work)
+{
+    int64_t start = k_uptime_get();
+
+    dfu_job_set_state(IMAGE_HANDLING_JOB_COPYING);
+    int err = -ENOENT;
+#if CONFIG_MIRA_FOTA_COMPRESSED
+    /* A compressed image is distributed from the second slot instead */
+    err = fota_driver_stage_compressed_upload();
+#endif
+    bool compressed = err != -ENOENT;
+    if (!compressed) {
+        err = fota_driver_copy_trailer_page();
+        if (err == 0) {
+            err = fota_driver_copy_header_page();
+        }
+    }
+    int64_t copied = k_uptime_get();
+
+    if (err == 0 && !compressed) {
+        dfu_job_set_state(IMAGE_HANDLING_JOB_HASHING);
+        /* Writing the Mira FOTA header makes the image available to MiraMesh */
+        err = fota_driver_write_new_header();
+    }
+    int64_t done = k_uptime_get();
 
+    k_mutex_lock(&dfu_job_lock, K_FOREVER);
+    dfu_job_status.copy_ms = copied - start;
+    dfu_job_status.hash_ms = done - copied;
+    dfu_job_status.total_ms = done - dfu_job_pending_time;
+    dfu_job_status.error = err;
+    dfu_job_status.state = err == 0 ? IMAGE_HANDLING_JOB_READY
+                           : IMAGE_HANDLING_JOB_FAILED;
+    k_mutex_unlock(&dfu_job_lock);
+
+    printf("DFU job %s: %d, copy %u ms, hash %u ms, total %u ms\n",
+        image_handling_job_state_str(dfu_job_status.state),
+        err,
+        dfu_job_status.copy_ms,
+        dfu_job_status.hash_ms,
+        dfu_job_status.total_ms);
+}
+
+#if CONFIG_MIRA_FOTA_COMPRESSED
+static struct k_work install_work;
+
+static void install_job_handler(
+    struct k_work *work)
+{
+    int64_t start = k_uptime_get();
+
+    dfu_job_set_state(IMAGE_HANDLING_JOB_EXPANDING);
+    int err = fota_driver_expand_second_slot();
+    int64_t done = k_uptime_get();
+
+    k_mutex_lock(&dfu_job_lock, K_FOREVER);
+    dfu_job_status.expand_ms = done - start;
+    dfu_job_status.error = err;
+    dfu_job_status.state = err == 0 ? IMAGE_HANDLING_JOB_READY
+                           : IMAGE_HANDLING_JOB_FAILED;
+    k_mutex_unlock(&dfu_job_lock);
+
+    printf("Install job %s: %d, expand %u ms\n",
+        image_handling_job_state_str(dfu_job_status.state),
+        err,
+        dfu_job_status.expand_ms);
+    if (err == 0) {
+        image_handling_mark_for_swap();
+    }
+}
+
+void image_handling_install_compressed(
+    void)
+{
+    k_work_submit_to_queue(&dfu_job_queue, &install_work);
+}
+#endif /* CONFIG_MIRA_FOTA_COMPRESSED */
+
+const char *image_handling_job_state_str(
+    enum image_handling_job_state state)
+{
+    switch (state) {
+        case IMAGE_HANDLING_JOB_IDLE:
+            return "idle";
+        case IMAGE_HANDLING_JOB_PENDING:
+            return "pending";
+        case IMAGE_HANDLING_JOB_COPYING:
+            return "copying";
+        case IMAGE_HANDLING_JOB_HASHING:
+            return "hashing";
+        case IMAGE_HANDLING_JOB_EXPANDING:
+            return "expanding";
+        case IMAGE_HANDLING_JOB_READY:
+            return "ready";
+        case IMAGE_HANDLING_JOB_FAILED:
+            return "failed";
+    }
+    return "UNKNOWN";
+}
+
+void image_handling_get_job_status(
+    struct image_handling_job_status *status)
+{
+    k_mutex_lock(&dfu_job_lock, K_FOREVER);
+    *status = dfu_job_status;
+    k_mutex_unlock(&dfu_job_lock);
+}
+
+#if CONFIG_SHELL
+static int cmd_dfu_job(
+    const struct shell *sh,
+    size_t argc,
+    char **argv)
+{
+    struct image_handling_job_status status;
+
+    image_handling_get_job_status(&status);
+    shell_print(sh, "state: %s", image_handling_job_state_str(status.state));
+    shell_print(sh, "error: %d", status.error);
+    shell_print(sh, "copy: %u ms, hash: %u ms, total: %u ms",
+        status.copy_ms,
+        status.hash_ms,
+        status.total_ms);
+#if CONFIG_MIRA_FOTA_COMPRESSED
+    shell_print(sh, "expand: %u ms", status.expand_ms);
+#endif
+    return 0;
+}
+
+SHELL_CMD_REGISTER(dfu_job, NULL, "Show the state of the DFU post-processing job",
+    cmd_dfu_job);
+#endif /* CONFIG_SHELL */
+
+/* Same fields as the shell command, as a CBOR map */
+static int dfu_job_mgmt_read(
+    struct smp_streamer *ctxt)
+{
+    zcbor_state_t *zse = ctxt->writer->zs;
+    struct image_handling_job_status status;
+    const char *state;
+
+    image_handling_get_job_status(&status);
+    state = image_handling_job_state_str(status.state);
+    bool ok = zcbor_tstr_put_lit(zse, "state")
+        && zcbor_tstr_put_term(zse, state, strlen(state) + 1)
+        && zcbor_tstr_put_lit(zse, "error")
+        && zcbor_int32_put(zse, status.error)
+        && zcbor_tstr_put_lit(zse, "copy_ms")
+        && zcbor_uint32_put(zse, status.copy_ms)
+        && zcbor_tstr_put_lit(zse, "hash_ms")
+        && zcbor_uint32_put(zse, status.hash_ms)
+        && zcbor_tstr_put_lit(zse, "total_ms")
+        && zcbor_uint32_put(zse, status.total_ms);
+#if CONFIG_MIRA_FOTA_COMPRESSED
+    ok = ok
+        && zcbor_tstr_put_lit(zse, "expand_ms")
+        && zcbor_uint32_put(zse, status.expand_ms);
+#endif
+    return ok ? MGMT_ERR_EOK : MGMT_ERR_EMSGSIZE;
+}
+
+static const struct mgmt_handler dfu_job_mgmt_handlers[] = {
+    [IMAGE_HANDLING_MGMT_ID_JOB_STATUS] = {
+        .mh_read = dfu_job_mgmt_read,
+        .mh_write = NULL
+    },
+};
+
+static struct mgmt_group dfu_job_mgmt_group = {
+    .mg_handlers = dfu_job_mgmt_handlers,
+    .mg_handlers_count = ARRAY_SIZE(dfu_job_mgmt_handlers),
+    .mg_group_id = IMAGE_HANDLING_MGMT_GROUP_ID
+};
+
+static void dfu_job_mgmt_register(
+    void)
+{
+    mgmt_register_group(&dfu_job_mgmt_group);
+}
+
+MCUMGR_HANDLER_DEFINE(dfu_job_mgmt, dfu_job_mgmt_register);
+
+#if CONFIG_MIRA_FOTA_CRC_TRACK_UPLOAD
+/* Feed uploaded chunks to the image checksum as they arrive */
+enum mgmt_cb_return dfu_chunk_tracker(
+    uint32_t event,
+    enum mgmt_cb_return prev_status,
+    int32_t *rc,
+    uint16_t *group,
+    bool *abort_more,
+    void *data,
+    size_t data_size)
+{
+    if (event == MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK) {
+        const struct img_mgmt_upload_check *check = data;
+        if (check->req->image == 0) {
+            fota_driver_image_crc_update(check->req->off,
+                check->req->img_data.value,
+                check->req->img_data.len);
+        }
+    } else if (event == MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED) {
+        fota_driver_image_crc_reset();
     }
     return MGMT_CB_OK;
 }
+#endif /* CONFIG_MIRA_FOTA_CRC_TRACK_UPLOAD */
 
 /* Block reset requests by connected peer */
 enum mgmt_cb_return block_reset_checker(
@@ -82,10 +332,32 @@ void image_handling_mark_for_swap(
 void image_handling_init(
     void)
 {
+    const struct k_work_queue_config dfu_job_queue_config = {
+        .name = "dfu_job"
+    };
+
+    k_work_queue_init(&dfu_job_queue);
+    k_work_queue_start(&dfu_job_queue,
+        dfu_job_stack,
+        K_THREAD_STACK_SIZEOF(dfu_job_stack),
+        CONFIG_MIRA_FOTA_DFU_JOB_PRIORITY,
+        &dfu_job_queue_config);
+    k_work_init(&dfu_job_work, dfu_job_handler);
+#if CONFIG_MIRA_FOTA_COMPRESSED
+    k_work_init(&install_work, install_job_handler);
+#endif
+
     dfu_done_cb.callback = dfu_done_checker;
-    dfu_done_cb.event_id = MGMT_EVT_OP_IMG_MGMT_DFU_PENDING;
+    dfu_done_cb.event_id = MGMT_EVT_OP_IMG_MGMT_DFU_STARTED
+        | MGMT_EVT_OP_IMG_MGMT_DFU_PENDING;
     mgmt_callback_register(&dfu_done_cb);
     block_reset_cb.callback = block_reset_checker;
     block_reset_cb.event_id = MGMT_EVT_OP_OS_MGMT_RESET;
     mgmt_callback_register(&block_reset_cb);
+#if CONFIG_MIRA_FOTA_CRC_TRACK_UPLOAD
+    dfu_chunk_cb.callback = dfu_chunk_tracker;
+    dfu_chunk_cb.event_id = MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK
+        | MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED;
+    mgmt_callback_register(&dfu_chunk_cb);
+#endif
 }
@@ -28,10 +28,67 @@
 #ifndef IMAGE_HANDLING_H
 #define IMAGE_HANDLING_H
 
+#include <stdint.h>
+
+#include <zephyr/mgmt/mcumgr/mgmt/mgmt_defines.h>
+
+/*
+ * mcumgr group of the DFU job, with a single read command returning a
+ * map with the fields of struct image_handling_job_status: state (text),
+ * error, copy_ms, hash_ms, total_ms and, with compressed images,
+ * expand_ms.
+ */
+#define IMAGE_HANDLING_MGMT_GROUP_ID MGMT_GROUP_ID_PERUSER
+#define IMAGE_HANDLING_MGMT_ID_JOB_STATUS 0
+
+/* States of the job preparing a BLE uploaded image for MiraMesh FOTA */
+enum image_handling_job_state {
+    IMAGE_HANDLING_JOB_IDLE,
+    IMAGE_HANDLING_JOB_PENDING,
+    IMAGE_HANDLING_JOB_COPYING,
+    IMAGE_HANDLING_JOB_HASHING,
+    IMAGE_HANDLING_JOB_EXPANDING,
+    IMAGE_HANDLING_JOB_READY,
+    IMAGE_HANDLING_JOB_FAILED
+};
+
+struct image_handling_job_status {
+    enum image_handling_job_state state;
+    /* Error of the step that failed, 0 otherwise */
+    int error;
+    /* Time spent copying the header and trailer pages */
+    uint32_t copy_ms;
+    /* Time spent computing the checksum and writing the Mira FOTA header */
+    uint32_t hash_ms;
+    /* Time from the upload being done until the job finished */
+    uint32_t total_ms;
+    /* Time spent expanding a compressed image into the SWAP area */
+    uint32_t expand_ms;
+};
+
 void image_handling_mark_for_swap(
     void);
 
 void image_handling_init(
     void);
 
+#if CONFIG_MIRA_FOTA_COMPRESSED
+/**
+ * Expand the compressed image in the second FOTA slot into the SWAP area
+ * in the background, and mark it for swap when done.
+ */
+void image_handling_install_compressed(
+    void);
+#endif
+
+/**
+ * Get the state and timing of the job preparing the last image uploaded
+ * over BLE for MiraMesh FOTA.
+ */
+void image_handling_get_job_status(
+    struct image_handling_job_status *status);
+
+const char *image_handling_job_state_str(
+    enum image_handling_job_state state);
+
 #endif /* IMAGE_HANDLING_H */
@@ -0,0 +1,311 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "echo.h"
+#include "root_rx.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <miramesh.h>
+
+#define ECHO_MAGIC 0x50455a4d /* "MZEP" */
+#define ECHO_HEADER_SIZE 12
+
+#if CONFIG_ECHO_SERVICE
+static mira_net_udp_connection_t *service_conn;
+static int64_t window_start;
+static uint32_t window_replies;
+
+/* Called from the root receive thread, not from the MiraMesh callback */
+static void answer_probe(
+    const struct root_rx_packet *packet)
+{
+    int64_t now = k_uptime_get();
+
+    if (packet->length < ECHO_HEADER_SIZE || sys_get_le32(&packet->data[0]) != ECHO_MAGIC) {
+        return;
+    }
+    if (now - window_start >= MSEC_PER_SEC) {
+        window_start = now;
+        window_replies = 0;
+    }
+    if (window_replies >= CONFIG_ECHO_SERVICE_MAX_REPLIES_PER_S) {
+        return;
+    }
+    window_replies++;
+    mira_net_udp_send_to(service_conn,
+        &packet->source_address,
+        packet->source_port,
+        packet->data,
+        packet->length);
+}
+
+void echo_service_init(
+    void)
+{
+    service_conn = mira_net_udp_connect(NULL, 0, NULL, NULL);
+    mira_status_t res = root_rx_listen(ECHO_UDP_PORT, answer_probe);
+    if (service_conn == NULL || res != MIRA_SUCCESS) {
+        printf("Echo service failed to start: %d\n", res);
+    }
+}
+#endif
+
+#if CONFIG_ECHO_PROBE
+struct probe {
+    bool used;
+    uint32_t number;
+    uint32_t sent_time;
+};
+
+static struct k_spinlock probe_lock;
+static struct probe probes[CONFIG_ECHO_PROBE_MAX_OUTSTANDING];
+static struct echo_stats stats;
+static uint32_t next_number;
+
+static mira_net_udp_connection_t *conn;
+static uint8_t payload[CONFIG_ECHO_PROBE_PAYLOAD_SIZE];
+
+extern const k_tid_t echo_probe_thread_id;
+
+/* 0-7 ms exactly, then four buckets per power of two */
+static uint32_t bucket_index(
+    uint32_t rtt)
+{
+    if (rtt < 8) {
+        return rtt;
+    }
+    uint32_t exponent = 31 - __builtin_clz(rtt);
+    uint32_t index = 4 * (exponent - 1) + ((rtt >> (exponent - 2)) & 3);
+    return MIN(index, ECHO_HISTOGRAM_BUCKETS - 1);
+}
+
+static uint32_t bucket_start(
+    uint32_t index)
+{
+    if (index < 8) {
+        return index;
+    }
+    return (4 + index % 4) << (index / 4 - 1);
+}
+
+static void record_rtt(
+    uint32_t rtt)
+{
+    if (stats.replies == 0 || rtt < stats.rtt_min) {
+        stats.rtt_min = rtt;
+    }
+    stats.rtt_max = MAX(stats.rtt_max, rtt);
+    stats.rtt_sum += rtt;
+    stats.replies++;
+    stats.histogram[bucket_index(rtt)]++;
+}
+
+static void reply_callback(
+    mira_net_udp_connection_t *connection,
+    const void *data,
+    uint16_t data_len,
+    const mira_net_udp_callback_metadata_t *metadata,
+    void *storage)
+{
+    const uint8_t *bytes = data;
+    uint32_t now = k_uptime_get_32();
+
+    if (data_len < ECHO_HEADER_SIZE || sys_get_le32(&bytes[0]) != ECHO_MAGIC) {
+        return;
+    }
+    uint32_t number = sys_get_le32(&bytes[4]);
+
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+    stats.hop_count = metadata->hop_count;
+    for (int i = 0; i < CONFIG_ECHO_PROBE_MAX_OUTSTANDING; i++) {
+        if (probes[i].used && probes[i].number == number) {
+            probes[i].used = false;
+            record_rtt(now - probes[i].sent_time);
+            k_spin_unlock(&probe_lock, key);
+            return;
+        }
+    }
+    stats.late++;
+    k_spin_unlock(&probe_lock, key);
+}
+
+/* Slot for a new probe, expiring probes that have waited too long */
+static struct probe *claim_probe(
+    uint32_t now)
+{
+    struct probe *free = NULL;
+    struct probe *oldest = &probes[0];
+
+    for (int i = 0; i < CONFIG_ECHO_PROBE_MAX_OUTSTANDING; i++) {
+        struct probe *probe = &probes[i];
+        if (probe->used && now - probe->sent_time >= CONFIG_ECHO_PROBE_TIMEOUT_MS) {
+            probe->used = false;
+            stats.timeouts++;
+        }
+        if (!probe->used) {
+            free = free != NULL ? free : probe;
+        } else if (now - probe->sent_time > now - oldest->sent_time) {
+            oldest = probe;
+        }
+    }
+    if (free == NULL) {
+        stats.timeouts++;
+        free = oldest;
+    }
+    return free;
+}
+
+static void send_probe(
+    const mira_net_address_t *root_address)
+{
+    uint32_t now = k_uptime_get_32();
+
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+    struct probe *probe = claim_probe(now);
+    uint32_t number = next_number++;
+    probe->used = true;
+    probe->number = number;
+    probe->sent_time = now;
+    stats.sent++;
+    k_spin_unlock(&probe_lock, key);
+
+    sys_put_le32(ECHO_MAGIC, &payload[0]);
+    sys_put_le32(number, &payload[4]);
+    sys_put_le32(now, &payload[8]);
+    if (mira_net_udp_send_to(conn, root_address, ECHO_UDP_PORT, payload,
+        sizeof(payload)) != MIRA_SUCCESS) {
+        key = k_spin_lock(&probe_lock);
+        if (probe->number == number) {
+            probe->used = false;
+        }
+        stats.sent--;
+        stats.send_errors++;
+        k_spin_unlock(&probe_lock, key);
+    }
+}
+
+/* Upper end of the bucket holding the given share of the replies */
+static uint32_t percentile(
+    const struct echo_stats *s,
+    uint32_t permille)
+{
+    uint32_t target = ((uint64_t) s->replies * permille + 999) / 1000;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < ECHO_HISTOGRAM_BUCKETS; i++) {
+        count += s->histogram[i];
+        if (count >= target) {
+            uint32_t end = i + 1 < ECHO_HISTOGRAM_BUCKETS ? bucket_start(i + 1) - 1 : s->rtt_max;
+            return MIN(end, s->rtt_max);
+        }
+    }
+    return s->rtt_max;
+}
+
+static void print_report(
+    void)
+{
+    struct echo_stats s;
+
+    echo_probe_get_stats(&s);
+    printf("RTT: %u probes, %u replies, %u timeouts, %u late, %u send errors, %u hops\n",
+        s.sent,
+        s.replies,
+        s.timeouts,
+        s.late,
+        s.send_errors,
+        s.hop_count);
+    if (s.replies == 0) {
+        return;
+    }
+    printf("RTT: min %u avg %u p95 %u max %u ms\n",
+        s.rtt_min,
+        (uint32_t) (s.rtt_sum / s.replies),
+        percentile(&s, 950),
+        s.rtt_max);
+    for (uint32_t i = 0; i < ECHO_HISTOGRAM_BUCKETS; i++) {
+        if (s.histogram[i] == 0) {
+            continue;
+        }
+        if (i + 1 < ECHO_HISTOGRAM_BUCKETS) {
+            printf("RTT %5u-%-5u ms: %u\n", bucket_start(i), bucket_start(i + 1) - 1,
+                s.histogram[i]);
+        } else {
+            printf("RTT %5u+      ms: %u\n", bucket_start(i), s.histogram[i]);
+        }
+    }
+}
+
+static void echo_probe_thread(
+    void)
+{
+    int64_t next_report = k_uptime_get() + CONFIG_ECHO_PROBE_REPORT_INTERVAL_MS;
+
+    while (1) {
+        mira_net_address_t root_address;
+
+        if (mira_net_get_state() == MIRA_NET_STATE_JOINED
+            && mira_net_get_root_address(&root_address) == MIRA_SUCCESS) {
+            send_probe(&root_address);
+        }
+        if (k_uptime_get() >= next_report) {
+            print_report();
+            next_report += CONFIG_ECHO_PROBE_REPORT_INTERVAL_MS;
+        }
+        k_sleep(K_MSEC(CONFIG_ECHO_PROBE_INTERVAL_MS));
+    }
+}
+
+K_THREAD_DEFINE(echo_probe_thread_id,
+    CONFIG_ECHO_PROBE_STACK_SIZE,
+    echo_probe_thread,
+    NULL,
+    NULL,
+    NULL,
+    CONFIG_ECHO_PROBE_PRIORITY,
+    0,
+    SYS_FOREVER_MS);
+
+void echo_probe_init(
+    void)
+{
+    conn = mira_net_udp_connect(NULL, 0, reply_callback, NULL);
+    k_thread_start(echo_probe_thread_id);
+}
+
+void echo_probe_get_stats(
+    struct echo_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+    *out = stats;
+    k_spin_unlock(&probe_lock, key);
+}
+#endif /* CONFIG_ECHO_PROBE */
@@ -0,0 +1,89 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ECHO_H
+#define ECHO_H
+
+#include <stdint.h>
+
+/*
+ * Round trip time measurement. With CONFIG_ECHO_SERVICE the root sends
+ * probes received on ECHO_UDP_PORT back to their source unchanged, and
+ * drops other packets. Nodes with CONFIG_ECHO_PROBE send probes to it
+ * and match the replies against the probes waiting for one.
+ *
+ * Probe payload, little endian:
+ *
+ * Offset | Size | Field
+ * -------|------|----------------------------------------------
+ * 0      | 4    | Magic, "MZEP"
+ * 4      | 4    | Probe number
+ * 8      | 4    | Uptime of the sender when sent, ms
+ * 12     | -    | Zero padding up to CONFIG_ECHO_PROBE_PAYLOAD_SIZE
+ *
+ * Round trip times are kept in a histogram with four buckets per power
+ * of two, so percentiles are reported with at most 25% error.
+ */
+
+#define ECHO_UDP_PORT 459
+
+#define ECHO_HISTOGRAM_BUCKETS 64
+
+struct echo_stats {
+    uint32_t sent;
+    uint32_t replies;
+    /* Probes without a reply within CONFIG_ECHO_PROBE_TIMEOUT_MS */
+    uint32_t timeouts;
+    /* Replies to probes that had already timed out, or unknown probes */
+    uint32_t late;
+    /* Failed sends, for example while not joined */
+    uint32_t send_errors;
+    uint32_t rtt_min;
+    uint32_t rtt_max;
+    uint64_t rtt_sum;
+    /* Hops of the last reply from the root */
+    uint8_t hop_count;
+    uint32_t histogram[ECHO_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Start the echo service on the root. Probes are answered from the root
+ * receive thread, at most CONFIG_ECHO_SERVICE_MAX_REPLIES_PER_S a second.
+ */
+void echo_service_init(
+    void);
+
+/**
+ * Start sending probes to the root, from a thread of its own.
+ */
+void echo_probe_init(
+    void);
+
+void echo_probe_get_stats(
+    struct echo_stats *stats);
+
+#endif /* ECHO_H */
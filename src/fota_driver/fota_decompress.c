@@ -0,0 +1,208 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_decompress.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
+#include <string.h>
+
+#define MCUBOOT_IMAGE_MAGIC 0x96f3b83d
+#define MCUBOOT_IMAGE_F_NON_BOOTABLE 0x00000010
+#define MCUBOOT_FLAGS_OFFSET 16
+
+static const uint8_t compressed_magic[4] = {
+    'M', 'Z', 'C', '1'
+};
+
+int fota_decompress_parse_header(
+    const uint8_t *data,
+    struct fota_decompress_header *header)
+{
+    const uint8_t *hdr = &data[FOTA_DECOMPRESS_MCUBOOT_HEADER_SIZE];
+
+    if (sys_get_le32(data) != MCUBOOT_IMAGE_MAGIC
+        || !(sys_get_le32(&data[MCUBOOT_FLAGS_OFFSET])
+             & MCUBOOT_IMAGE_F_NON_BOOTABLE)
+        || memcmp(hdr, compressed_magic, sizeof(compressed_magic)) != 0) {
+        return -ENOENT;
+    }
+    /* hdr[4] is the format version, 1 */
+    if (hdr[4] != 1) {
+        return -ENOTSUP;
+    }
+    header->window_bits = hdr[5];
+    header->lookahead_bits = hdr[6];
+    header->flags = hdr[7];
+    header->image_size = sys_get_le32(&hdr[8]);
+    header->stream_offset = FOTA_DECOMPRESS_CONTAINER_HEADER_SIZE;
+    header->stream_size = sys_get_le32(&hdr[12]);
+    if (header->flags & FOTA_DECOMPRESS_FLAG_DELTA) {
+        if (!IS_ENABLED(CONFIG_MIRA_FOTA_DELTA)) {
+            return -ENOTSUP;
+        }
+        header->stream_offset += FOTA_DECOMPRESS_DELTA_HEADER_SIZE;
+    }
+    if ((header->flags & ~FOTA_DECOMPRESS_FLAG_DELTA) != 0
+        || header->window_bits < 4
+        || header->window_bits > CONFIG_MIRA_FOTA_COMPRESSED_WINDOW_BITS
+        || header->lookahead_bits < 1
+        || header->lookahead_bits >= header->window_bits) {
+        return -ENOTSUP;
+    }
+    return 0;
+}
+
+void fota_decompress_init(
+    struct fota_decompress *dec,
+    const struct fota_decompress_header *header,
+    fota_decompress_output_fn output,
+    void *ctx)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->header = *header;
+    dec->state = FOTA_DECOMPRESS_TAG;
+    dec->output = output;
+    dec->ctx = ctx;
+}
+
+static int flush_output(
+    struct fota_decompress *dec)
+{
+    if (dec->out_length == 0) {
+        return 0;
+    }
+    int ret = dec->output(dec->out, dec->out_length, dec->ctx);
+    dec->out_length = 0;
+    return ret;
+}
+
+static int emit(
+    struct fota_decompress *dec,
+    uint8_t byte)
+{
+    uint32_t mask = BIT(dec->header.window_bits) - 1;
+    dec->window[dec->produced & mask] = byte;
+    dec->produced++;
+    dec->out[dec->out_length++] = byte;
+    if (dec->out_length == sizeof(dec->out)) {
+        return flush_output(dec);
+    }
+    return 0;
+}
+
+/* Bits the current state needs before it can proceed */
+static uint8_t bits_needed(
+    const struct fota_decompress *dec)
+{
+    switch (dec->state) {
+        case FOTA_DECOMPRESS_TAG:
+            return 1;
+        case FOTA_DECOMPRESS_LITERAL:
+            return 8;
+        case FOTA_DECOMPRESS_DISTANCE:
+            return dec->header.window_bits;
+        case FOTA_DECOMPRESS_LENGTH:
+            return dec->header.lookahead_bits;
+    }
+    return 1;
+}
+
+static int step(
+    struct fota_decompress *dec,
+    uint32_t value)
+{
+    switch (dec->state) {
+        case FOTA_DECOMPRESS_TAG:
+            dec->state = value ? FOTA_DECOMPRESS_LITERAL : FOTA_DECOMPRESS_DISTANCE;
+            return 0;
+        case FOTA_DECOMPRESS_LITERAL:
+            dec->state = FOTA_DECOMPRESS_TAG;
+            return emit(dec, value);
+        case FOTA_DECOMPRESS_DISTANCE:
+            dec->distance = value + 1;
+            dec->state = FOTA_DECOMPRESS_LENGTH;
+            return 0;
+        case FOTA_DECOMPRESS_LENGTH: {
+            uint32_t length = value + 1;
+            uint32_t mask = BIT(dec->header.window_bits) - 1;
+            if (dec->distance > dec->produced
+                || length > dec->header.image_size - dec->produced) {
+                return -EINVAL;
+            }
+            for (uint32_t i = 0; i < length; i++) {
+                int ret = emit(dec,
+                    dec->window[(dec->produced - dec->distance) & mask]);
+                if (ret != 0) {
+                    return ret;
+                }
+            }
+            dec->state = FOTA_DECOMPRESS_TAG;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+int fota_decompress_feed(
+    struct fota_decompress *dec,
+    const uint8_t *data,
+    uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        dec->bits = (dec->bits << 8) | data[i];
+        dec->bit_count += 8;
+        while (dec->produced < dec->header.image_size) {
+            uint8_t needed = bits_needed(dec);
+            if (dec->bit_count < needed) {
+                break;
+            }
+            dec->bit_count -= needed;
+            uint32_t value = (dec->bits >> dec->bit_count) & (BIT(needed) - 1);
+            int ret = step(dec, value);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+        if (dec->produced == dec->header.image_size) {
+            /* The rest is padding of the last byte */
+            break;
+        }
+    }
+    return 0;
+}
+
+int fota_decompress_finish(
+    struct fota_decompress *dec)
+{
+    int ret = flush_output(dec);
+    if (ret != 0) {
+        return ret;
+    }
+    return dec->produced == dec->header.image_size ? 0 : -EINVAL;
+}
@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_DECOMPRESS_H
+#define FOTA_DECOMPRESS_H
+
+#include <stdint.h>
+
+/*
+ * Compressed FOTA container, as written by fota_pack.py:
+ *
+ * - An MCUboot image header marked non-bootable, so the container can be
+ *   uploaded with mcumgr like any image.
+ * - The compression header below, little endian.
+ * - With FOTA_DECOMPRESS_FLAG_DELTA, the delta header of fota_delta.h.
+ * - The LZSS bit stream: a 1 bit is followed by an 8 bit literal, a 0 bit
+ *   by window_bits of (distance - 1) and lookahead_bits of (length - 1),
+ *   most significant bit first.
+ */
+#define FOTA_DECOMPRESS_MCUBOOT_HEADER_SIZE 32
+#define FOTA_DECOMPRESS_HEADER_SIZE 16
+#define FOTA_DECOMPRESS_CONTAINER_HEADER_SIZE \
+    (FOTA_DECOMPRESS_MCUBOOT_HEADER_SIZE + FOTA_DECOMPRESS_HEADER_SIZE)
+#define FOTA_DECOMPRESS_DELTA_HEADER_SIZE 40
+#define FOTA_DECOMPRESS_MAX_HEADER_SIZE \
+    (FOTA_DECOMPRESS_CONTAINER_HEADER_SIZE + FOTA_DECOMPRESS_DELTA_HEADER_SIZE)
+
+/* The stream expands to a patch against the running image */
+#define FOTA_DECOMPRESS_FLAG_DELTA 0x01
+
+struct fota_decompress_header {
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t flags;
+    /* Size of the expanded stream */
+    uint32_t image_size;
+    /* Offset of the bit stream in the container */
+    uint32_t stream_offset;
+    /* Size of the bit stream */
+    uint32_t stream_size;
+};
+
+/**
+ * Function receiving expanded data, in order.
+ *
+ * @return 0 to continue, error to stop the decompression.
+ */
+typedef int (*fota_decompress_output_fn)(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx);
+
+enum fota_decompress_state {
+    FOTA_DECOMPRESS_TAG,
+    FOTA_DECOMPRESS_LITERAL,
+    FOTA_DECOMPRESS_DISTANCE,
+    FOTA_DECOMPRESS_LENGTH
+};
+
+struct fota_decompress {
+    struct fota_decompress_header header;
+    enum fota_decompress_state state;
+    uint32_t bits;
+    uint8_t bit_count;
+    uint32_t distance;
+    uint32_t produced;
+    uint8_t window[1 << CONFIG_MIRA_FOTA_COMPRESSED_WINDOW_BITS];
+    uint8_t out[CONFIG_MIRA_FOTA_COMPRESSED_OUTPUT_SIZE];
+    uint32_t out_length;
+    fota_decompress_output_fn output;
+    void *ctx;
+};
+
+/**
+ * Parse the header of a compressed container.
+ *
+ * @param data First FOTA_DECOMPRESS_MAX_HEADER_SIZE bytes of the
+ *             container.
+ *
+ * @return 0 on success, -ENOENT if the data is not a compressed container,
+ *         -ENOTSUP if the stream needs a larger window than configured or
+ *         is a delta image without CONFIG_MIRA_FOTA_DELTA.
+ */
+int fota_decompress_parse_header(
+    const uint8_t *data,
+    struct fota_decompress_header *header);
+
+void fota_decompress_init(
+    struct fota_decompress *dec,
+    const struct fota_decompress_header *header,
+    fota_decompress_output_fn output,
+    void *ctx);
+
+/**
+ * Expand the next part of the bit stream.
+ *
+ * @return 0 on success, -EINVAL on a corrupt stream, or the error of the
+ *         output function.
+ */
+int fota_decompress_feed(
+    struct fota_decompress *dec,
+    const uint8_t *data,
+    uint32_t length);
+
+/**
+ * Pass the remaining output on and check that the whole image was
+ * expanded.
+ *
+ * @return 0 on success, -EINVAL if the stream ended early.
+ */
+int fota_decompress_finish(
+    struct fota_decompress *dec);
+
+#endif /* FOTA_DECOMPRESS_H */
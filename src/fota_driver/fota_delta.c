@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_delta.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
+#include <string.h>
+
+#define MCUBOOT_IMAGE_MAGIC 0x96f3b83d
+#define MCUBOOT_HEADER_SIZE 32
+#define MCUBOOT_TLV_INFO_MAGIC 0x6907
+#define MCUBOOT_TLV_PROT_INFO_MAGIC 0x6908
+#define MCUBOOT_TLV_SHA256 0x10
+/* Bound on the TLVs searched for the hash */
+#define MCUBOOT_TLV_MAX_ENTRIES 16
+
+void fota_delta_parse_header(
+    const uint8_t *data,
+    struct fota_delta_header *header)
+{
+    header->image_size = sys_get_le32(&data[0]);
+    header->base_size = sys_get_le32(&data[4]);
+    memcpy(header->base_hash, &data[8], FOTA_DELTA_HASH_SIZE);
+}
+
+int fota_delta_image_hash(
+    fota_delta_read_fn read,
+    void *ctx,
+    uint8_t *hash,
+    uint32_t *size)
+{
+    uint8_t buf[MCUBOOT_HEADER_SIZE];
+    int ret = read(0, buf, MCUBOOT_HEADER_SIZE, ctx);
+    if (ret != 0) {
+        return ret;
+    }
+    if (sys_get_le32(buf) != MCUBOOT_IMAGE_MAGIC) {
+        return -ENOENT;
+    }
+    uint32_t offset = sys_get_le16(&buf[8]) + sys_get_le32(&buf[12]);
+    uint16_t protected_size = sys_get_le16(&buf[10]);
+
+    if (protected_size > 0) {
+        ret = read(offset, buf, 4, ctx);
+        if (ret != 0) {
+            return ret;
+        }
+        if (sys_get_le16(buf) != MCUBOOT_TLV_PROT_INFO_MAGIC) {
+            return -ENOENT;
+        }
+        offset += protected_size;
+    }
+    ret = read(offset, buf, 4, ctx);
+    if (ret != 0) {
+        return ret;
+    }
+    if (sys_get_le16(buf) != MCUBOOT_TLV_INFO_MAGIC) {
+        return -ENOENT;
+    }
+    uint32_t end = offset + sys_get_le16(&buf[2]);
+    offset += 4;
+
+    for (int i = 0; i < MCUBOOT_TLV_MAX_ENTRIES && offset + 4 <= end; i++) {
+        ret = read(offset, buf, 4, ctx);
+        if (ret != 0) {
+            return ret;
+        }
+        uint16_t type = sys_get_le16(&buf[0]);
+        uint16_t length = sys_get_le16(&buf[2]);
+        offset += 4;
+        if (type == MCUBOOT_TLV_SHA256 && length == FOTA_DELTA_HASH_SIZE) {
+            *size = end;
+            return read(offset, hash, FOTA_DELTA_HASH_SIZE, ctx);
+        }
+        offset += length;
+    }
+    return -ENOENT;
+}
+
+void fota_delta_init(
+    struct fota_delta *delta,
+    const struct fota_delta_header *header,
+    fota_delta_read_fn read_base,
+    fota_delta_output_fn output,
+    void *ctx)
+{
+    memset(delta, 0, sizeof(*delta));
+    delta->header = *header;
+    delta->state = FOTA_DELTA_RECORD;
+    delta->read_base = read_base;
+    delta->output = output;
+    delta->ctx = ctx;
+}
+
+static int start_record(
+    struct fota_delta *delta)
+{
+    uint32_t remaining = delta->header.image_size - delta->produced;
+
+    delta->diff_length = sys_get_le32(&delta->record[0]);
+    delta->extra_length = sys_get_le32(&delta->record[4]);
+    delta->seek = (int32_t) sys_get_le32(&delta->record[8]);
+    delta->record_length = 0;
+    if (delta->diff_length > remaining
+        || delta->extra_length > remaining - delta->diff_length
+        || delta->diff_length > delta->header.base_size - delta->base_position) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int end_record(
+    struct fota_delta *delta)
+{
+    int64_t position = (int64_t) delta->base_position + delta->seek;
+    if (position < 0 || position > delta->header.base_size) {
+        return -EINVAL;
+    }
+    delta->base_position = (uint32_t) position;
+    delta->state = FOTA_DELTA_RECORD;
+    return 0;
+}
+
+/* State following a finished part of a record */
+static int next_state(
+    struct fota_delta *delta)
+{
+    if (delta->diff_length > 0) {
+        delta->state = FOTA_DELTA_DIFF;
+        return 0;
+    }
+    if (delta->extra_length > 0) {
+        delta->state = FOTA_DELTA_EXTRA;
+        return 0;
+    }
+    return end_record(delta);
+}
+
+int fota_delta_feed(
+    struct fota_delta *delta,
+    const uint8_t *data,
+    uint32_t length)
+{
+    while (length > 0) {
+        uint32_t n;
+        int ret = 0;
+
+        switch (delta->state) {
+            case FOTA_DELTA_RECORD:
+                if (delta->produced == delta->header.image_size) {
+                    return -EINVAL;
+                }
+                n = MIN(length, FOTA_DELTA_RECORD_SIZE - delta->record_length);
+                memcpy(&delta->record[delta->record_length], data, n);
+                delta->record_length += n;
+                if (delta->record_length == FOTA_DELTA_RECORD_SIZE) {
+                    ret = start_record(delta);
+                    if (ret == 0) {
+                        ret = next_state(delta);
+                    }
+                }
+                break;
+            case FOTA_DELTA_DIFF:
+                n = MIN(MIN(length, delta->diff_length), sizeof(delta->buf));
+                ret = delta->read_base(delta->base_position, delta->buf, n,
+                    delta->ctx);
+                if (ret != 0) {
+                    return ret;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    delta->buf[i] += data[i];
+                }
+                ret = delta->output(delta->buf, n, delta->ctx);
+                delta->base_position += n;
+                delta->produced += n;
+                delta->diff_length -= n;
+                if (ret == 0 && delta->diff_length == 0) {
+                    ret = next_state(delta);
+                }
+                break;
+            case FOTA_DELTA_EXTRA:
+                n = MIN(length, delta->extra_length);
+                ret = delta->output(data, n, delta->ctx);
+                delta->produced += n;
+                delta->extra_length -= n;
+                if (ret == 0 && delta->extra_length == 0) {
+                    ret = end_record(delta);
+                }
+                break;
+            default:
+                return -EINVAL;
+        }
+        if (ret != 0) {
+            return ret;
+        }
+        data += n;
+        length -= n;
+    }
+    return 0;
+}
+
+int fota_delta_finish(
+    struct fota_delta *delta)
+{
+    if (delta->state != FOTA_DELTA_RECORD
+        || delta->produced != delta->header.image_size) {
+        return -EINVAL;
+    }
+    return 0;
+}
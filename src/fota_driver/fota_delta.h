@@ -0,0 +1,152 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_DELTA_H
+#define FOTA_DELTA_H
+
+#include <stdint.h>
+
+/*
+ * Delta FOTA images, as written by fota_pack.py --base.
+ *
+ * A delta image is a compressed container with FOTA_DECOMPRESS_FLAG_DELTA
+ * set, followed by the delta header below. The expanded stream is a
+ * patch against the image running in the MCUboot primary slot, made of
+ * records of three little endian 32 bit words:
+ *
+ * - diff_length: bytes that follow and are added, modulo 256, to the
+ *   base at the current base position, which then advances by
+ *   diff_length
+ * - extra_length: bytes that follow and are copied as they are
+ * - seek: signed adjustment of the base position
+ *
+ * The patched image is produced in order, one record at a time.
+ */
+#define FOTA_DELTA_HASH_SIZE 32
+#define FOTA_DELTA_RECORD_SIZE 12
+
+struct fota_delta_header {
+    /* Size of the patched image */
+    uint32_t image_size;
+    /* Size of the base image the patch applies to */
+    uint32_t base_size;
+    /* SHA256 of the base image, as in its MCUboot TLV */
+    uint8_t base_hash[FOTA_DELTA_HASH_SIZE];
+};
+
+/**
+ * Function reading from the base image.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+typedef int (*fota_delta_read_fn)(
+    uint32_t address,
+    uint8_t *data,
+    uint32_t length,
+    void *ctx);
+
+/**
+ * Function receiving patched data, in order.
+ *
+ * @return 0 to continue, error to stop patching.
+ */
+typedef int (*fota_delta_output_fn)(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx);
+
+enum fota_delta_state {
+    FOTA_DELTA_RECORD,
+    FOTA_DELTA_DIFF,
+    FOTA_DELTA_EXTRA
+};
+
+struct fota_delta {
+    struct fota_delta_header header;
+    enum fota_delta_state state;
+    uint8_t record[FOTA_DELTA_RECORD_SIZE];
+    uint8_t record_length;
+    uint32_t diff_length;
+    uint32_t extra_length;
+    int32_t seek;
+    uint32_t base_position;
+    uint32_t produced;
+    uint8_t buf[CONFIG_MIRA_FOTA_COMPRESSED_OUTPUT_SIZE];
+    fota_delta_read_fn read_base;
+    fota_delta_output_fn output;
+    void *ctx;
+};
+
+/**
+ * Parse the delta header following the compression header.
+ */
+void fota_delta_parse_header(
+    const uint8_t *data,
+    struct fota_delta_header *header);
+
+/**
+ * Find the SHA256 hash in the TLV area of an MCUboot image.
+ *
+ * @param read Function reading the image.
+ * @param hash Receives the hash.
+ * @param size Receives the size of the image including its TLVs.
+ *
+ * @return 0 on success, -ENOENT if there is no valid image or hash.
+ */
+int fota_delta_image_hash(
+    fota_delta_read_fn read,
+    void *ctx,
+    uint8_t *hash,
+    uint32_t *size);
+
+void fota_delta_init(
+    struct fota_delta *delta,
+    const struct fota_delta_header *header,
+    fota_delta_read_fn read_base,
+    fota_delta_output_fn output,
+    void *ctx);
+
+/**
+ * Apply the next part of the patch.
+ *
+ * @return 0 on success, -EINVAL on a corrupt patch, or the error of the
+ *         read or output function.
+ */
+int fota_delta_feed(
+    struct fota_delta *delta,
+    const uint8_t *data,
+    uint32_t length);
+
+/**
+ * Check that the whole image was produced.
+ *
+ * @return 0 on success, -EINVAL if the patch ended early.
+ */
+int fota_delta_finish(
+    struct fota_delta *delta);
+
+#endif /* FOTA_DELTA_H */
@@ -5,9 +5,30 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/flash.h>
+#if CONFIG_MIRA_FOTA_MMAP_READ && CONFIG_FLASH_SIMULATOR
+#include <zephyr/drivers/flash/flash_simulator.h>
+#endif
 #include <zephyr/logging/log.h>
 #include <zephyr/storage/flash_map.h>
 #include <devicetree_generated.h>
+#include <string.h>
+
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+#include "fota_write_queue.h"
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+#include "fota_write_combine.h"
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+#include "fota_read_cache.h"
+#endif
+#if CONFIG_MIRA_FOTA_COMPRESSED
+#include "fota_decompress.h"
+#endif
+#if CONFIG_MIRA_FOTA_DELTA
+#include "fota_delta.h"
+#endif
+#include "fota_stats.h"
 
 #define SWAP slot1_partition
 #define SWAP_DEVICE FIXED_PARTITION_DEVICE(SWAP)
@@ -25,8 +46,6 @@
 #define SWAP_ADDRESS(slot_address) (SWAP_OFFSET + (slot_address))
 #define HEADER_PAGE_ADDRESS(slot_address) (IMAGE_HEADER_PAGE_OFFSET \
                                            + (slot_address))
-#define TRAILER_PAGE_ADDRESS(slot_address) \
-    (IMAGE_TRAILER_PAGE_OFFSET + (slot_address - (SWAP_SIZE - FLASH_PAGE_SIZE)))
 
 #define FLASH_PAGE_SIZE 0x1000
 #define HEADER_PAGE_DATA_SIZE (FLASH_PAGE_SIZE)
@@ -35,6 +54,24 @@
 
 #define MIRA_HEADER_LOCATION (MCU_BOOT_HEADER_LOCATION - MIRA_FOTA_HEADER_SIZE)
 
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+#define SECOND_SLOT FOTA_SECOND_SLOT
+#define SECOND_SLOT_DEVICE FIXED_PARTITION_DEVICE(SECOND_SLOT)
+#define SECOND_SLOT_OFFSET FIXED_PARTITION_OFFSET(SECOND_SLOT)
+#define SECOND_SLOT_SIZE FIXED_PARTITION_SIZE(SECOND_SLOT)
+/* The first page of the partition is reserved for the Mira FOTA header */
+#define SECOND_SLOT_DATA_OFFSET (SECOND_SLOT_OFFSET + FLASH_PAGE_SIZE)
+#define SECOND_SLOT_DATA_SIZE (SECOND_SLOT_SIZE - FLASH_PAGE_SIZE)
+#endif
+
+#if CONFIG_MIRA_FOTA_DELTA
+/* The running image, which delta images are applied to */
+#define BASE slot0_partition
+#define BASE_DEVICE FIXED_PARTITION_DEVICE(BASE)
+#define BASE_OFFSET FIXED_PARTITION_OFFSET(BASE)
+#define BASE_SIZE FIXED_PARTITION_SIZE(BASE)
+#endif
+
 #if CONFIG_MIRA_FOTA_LOGGING
 LOG_MODULE_REGISTER(fota_driver, CONFIG_MIRA_FOTA_DRIVER_LOG_LEVEL);
 #else
@@ -43,6 +80,55 @@ LOG_MODULE_REGISTER(fota_driver, 0);
 
 extern const k_tid_t fota_swap_erase_worker_thread_id;
 
+/* Flash access of the driver, counted in the FOTA stats groups */
+static int fota_flash_read(
+    const struct device *dev,
+    off_t offset,
+    void *data,
+    size_t length,
+    enum fota_stats_op op,
+    enum fota_stats_area area)
+{
+    uint32_t begin = fota_stats_begin();
+    int ret = flash_read(dev, offset, data, length);
+    fota_stats_end(op, area, begin, length, ret);
+    return ret;
+}
+
+static int fota_flash_write(
+    const struct device *dev,
+    off_t offset,
+    const void *data,
+    size_t length,
+    enum fota_stats_op op,
+    enum fota_stats_area area)
+{
+    uint32_t begin = fota_stats_begin();
+    int ret = flash_write(dev, offset, data, length);
+    fota_stats_end(op, area, begin, length, ret);
+    if (ret != 0) {
+        LOG_ERR("Flash write of %u bytes at 0x%x failed: %d",
+            length,
+            (uint32_t) offset,
+            ret);
+    }
+    return ret;
+}
+
+static int fota_flash_erase(
+    const struct device *dev,
+    off_t offset,
+    enum fota_stats_area area)
+{
+    uint32_t begin = fota_stats_begin();
+    int ret = flash_erase(dev, offset, FLASH_PAGE_SIZE);
+    fota_stats_end(FOTA_STATS_ERASE, area, begin, FLASH_PAGE_SIZE, ret);
+    if (ret != 0) {
+        LOG_ERR("Flash erase at 0x%x failed: %d", (uint32_t) offset, ret);
+    }
+    return ret;
+}
+
 static bool address_in_header_page(
     uint32_t address)
 {
@@ -56,37 +142,359 @@ static bool address_in_trailer_page(
     return ((address + length > SWAP_SIZE - FLASH_PAGE_SIZE));
 }
 
-static uint32_t flash_check_overlapping(
+#define SWAP_PAGE_COUNT (SWAP_SIZE / FLASH_PAGE_SIZE)
+/* Page indexes of the backup pages, following the SWAP pages */
+#define HEADER_BACKUP_PAGE_INDEX (SWAP_PAGE_COUNT)
+#define TRAILER_BACKUP_PAGE_INDEX (SWAP_PAGE_COUNT + 1)
+#define TRACKED_PAGE_COUNT (SWAP_PAGE_COUNT + 2)
+
+/*
+ * Pages written since they were last erased. Pages written outside the
+ * driver are not tracked, so until an erase has checked every page for
+ * data (written_pages_known), pages without a bit are blank-checked
+ * before the erase skips them.
+ */
+static ATOMIC_DEFINE(written_pages, TRACKED_PAGE_COUNT);
+static bool written_pages_known = false;
+
+static void mark_written(
     uint32_t address,
     uint32_t length)
 {
-    if (!address_in_header_page(address + length - 1)
-        && address_in_header_page(address)) {
-        // In first page and overlapping, return overlap
-        return (address + length) - HEADER_PAGE_DATA_SIZE;
-        ;
+    if (length == 0) {
+        return;
+    }
+    for (uint32_t page = address / FLASH_PAGE_SIZE;
+         page <= (address + length - 1) / FLASH_PAGE_SIZE;
+         page++) {
+        atomic_set_bit(written_pages, page);
+    }
+    if (address_in_header_page(address)) {
+        atomic_set_bit(written_pages, HEADER_BACKUP_PAGE_INDEX);
+    }
+    if (address_in_trailer_page(address, length)) {
+        atomic_set_bit(written_pages, TRAILER_BACKUP_PAGE_INDEX);
+    }
+}
+
+static enum fota_stats_area page_area(
+    int index)
+{
+    if (index == HEADER_BACKUP_PAGE_INDEX) {
+        return FOTA_STATS_HEADER_MIRROR;
+    } else if (index == TRAILER_BACKUP_PAGE_INDEX) {
+        return FOTA_STATS_TRAILER_MIRROR;
     }
-    if (!address_in_trailer_page(address - 1,
-        0) && address_in_trailer_page(address, length)) {
-        // In second to last page and overlapping into last page, return overlap
-        return (address + length) - (SWAP_SIZE - FLASH_PAGE_SIZE);
+    return FOTA_STATS_BODY;
+}
+
+static bool page_is_blank(
+    const struct device *dev,
+    off_t offset,
+    enum fota_stats_area area)
+{
+    static uint32_t blank_check_buf[64];
+    for (uint32_t off = 0; off < FLASH_PAGE_SIZE; off += sizeof(blank_check_buf)) {
+        if (fota_flash_read(dev, offset + off, blank_check_buf,
+            sizeof(blank_check_buf), FOTA_STATS_READ, area) != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(blank_check_buf); i++) {
+            if (blank_check_buf[i] != 0xffffffff) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool page_needs_erase(
+    const struct device *dev,
+    off_t offset,
+    int index)
+{
+    bool written = atomic_test_and_clear_bit(written_pages, index);
+    if (written_pages_known) {
+        return written;
+    }
+    return written || !page_is_blank(dev, offset, page_area(index));
+}
+
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+/*
+ * Pages logically erased by the last fota_driver_erase, but not yet
+ * erased in flash. They read as 0xFF and are erased before the first
+ * write to them.
+ */
+static ATOMIC_DEFINE(stale_pages, TRACKED_PAGE_COUNT);
+static uint32_t lazy_erased_pages;
+
+static int erase_if_stale(
+    const struct device *dev,
+    off_t offset,
+    int index)
+{
+    if (atomic_test_and_clear_bit(stale_pages, index)
+        && page_needs_erase(dev, offset, index)) {
+        LOG_DBG("Erasing stale page at 0x%x", (uint32_t) offset);
+        int ret = fota_flash_erase(dev, offset, page_area(index));
+        if (ret != 0) {
+            return ret;
+        }
+        lazy_erased_pages++;
     }
     return 0;
 }
 
+/*
+ * Logically erase slot 0. The header backup page, holding the Mira FOTA
+ * header, is erased at once: the stale bitmap is only kept in RAM, and
+ * the header of the previous image must not read as valid after a reset.
+ */
+static int mark_all_stale(
+    void)
+{
+    for (int i = 0; i < TRACKED_PAGE_COUNT; i++) {
+        atomic_set_bit(stale_pages, i);
+    }
+    return erase_if_stale(IMAGE_HEADER_PAGE_DEVICE, IMAGE_HEADER_PAGE_OFFSET,
+        HEADER_BACKUP_PAGE_INDEX);
+}
+
+/* Stale state of the page a slot address is read from */
+static bool slot_page_is_stale(
+    uint32_t page)
+{
+    if (page == 0) {
+        return atomic_test_bit(stale_pages, HEADER_BACKUP_PAGE_INDEX);
+    } else if (page == SWAP_PAGE_COUNT - 1) {
+        return atomic_test_bit(stale_pages, TRAILER_BACKUP_PAGE_INDEX);
+    }
+    return atomic_test_bit(stale_pages, page);
+}
+
+/*
+ * Fill the parts of a read that fall in stale pages with 0xFF.
+ * Returns true if the whole range is stale.
+ */
+static bool fill_stale_pages(
+    uint8_t *data,
+    uint32_t address,
+    uint32_t length)
+{
+    bool all_stale = true;
+    uint32_t end = address + length;
+    while (address < end) {
+        uint32_t page = address / FLASH_PAGE_SIZE;
+        uint32_t n = MIN(end, (page + 1) * FLASH_PAGE_SIZE) - address;
+        if (slot_page_is_stale(page)) {
+            memset(data, 0xff, n);
+        } else {
+            all_stale = false;
+        }
+        data += n;
+        address += n;
+    }
+    return all_stale;
+}
+#endif /* CONFIG_MIRA_FOTA_LAZY_ERASE */
+
+/*
+ * Make sure the SWAP and backup pages a write to the slot range goes to
+ * are erased.
+ */
+static int prepare_pages_for_write(
+    uint32_t address,
+    uint32_t length)
+{
+    int ret = 0;
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    if (length == 0) {
+        return 0;
+    }
+    for (uint32_t page = address / FLASH_PAGE_SIZE;
+         page <= (address + length - 1) / FLASH_PAGE_SIZE && ret == 0;
+         page++) {
+        ret = erase_if_stale(SWAP_DEVICE, SWAP_ADDRESS(page * FLASH_PAGE_SIZE), page);
+    }
+    if (ret == 0 && address_in_header_page(address)) {
+        ret = erase_if_stale(IMAGE_HEADER_PAGE_DEVICE, IMAGE_HEADER_PAGE_OFFSET,
+            HEADER_BACKUP_PAGE_INDEX);
+    }
+    if (ret == 0 && address_in_trailer_page(address, length)) {
+        ret = erase_if_stale(IMAGE_TRAILER_PAGE_DEVICE, IMAGE_TRAILER_PAGE_OFFSET,
+            TRAILER_BACKUP_PAGE_INDEX);
+    }
+#endif
+    return ret;
+}
+
+void fota_driver_swap_written_externally(
+    void)
+{
+    written_pages_known = false;
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    fota_read_cache_invalidate_slot(FOTA_SLOT_ID);
+#endif
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    /* The SWAP pages are managed by whoever writes them now */
+    for (int i = 0; i < SWAP_PAGE_COUNT; i++) {
+        atomic_clear_bit(stale_pages, i);
+    }
+#endif
+}
+
+/*
+ * Layout of slot 0. All data is written to the SWAP partition at the slot
+ * address. The first and last page are also mirrored to the backup pages,
+ * and reads of those pages are served from the backups. The Mira FOTA
+ * header lives in the header backup page, so that part of the first page
+ * reads as 0xFF and is only written to SWAP.
+ */
+enum fota_region_policy {
+    /* Read from and written to SWAP only */
+    REGION_DIRECT,
+    /* Written to SWAP and the backing page, read from the backing page */
+    REGION_MIRROR,
+    /* Written to SWAP only, reads are filled with 0xFF */
+    REGION_MASK
+};
+
+struct fota_region {
+    uint32_t start;
+    uint32_t end;
+    enum fota_region_policy policy;
+    const struct device *dev;
+    off_t offset;
+    /* Where accesses to dev are counted */
+    enum fota_stats_area area;
+};
+
+static const struct fota_region slot0_regions[] = {
+    {
+        .start = 0,
+        .end = MIRA_HEADER_LOCATION,
+        .policy = REGION_MIRROR,
+        .dev = IMAGE_HEADER_PAGE_DEVICE,
+        .offset = HEADER_PAGE_ADDRESS(0),
+        .area = FOTA_STATS_HEADER_MIRROR
+    },
+    {
+        .start = MIRA_HEADER_LOCATION,
+        .end = MCU_BOOT_HEADER_LOCATION,
+        .policy = REGION_MASK
+    },
+    {
+        .start = MCU_BOOT_HEADER_LOCATION,
+        .end = HEADER_PAGE_DATA_SIZE,
+        .policy = REGION_MIRROR,
+        .dev = IMAGE_HEADER_PAGE_DEVICE,
+        .offset = HEADER_PAGE_ADDRESS(MCU_BOOT_HEADER_LOCATION),
+        .area = FOTA_STATS_HEADER_MIRROR
+    },
+    {
+        .start = HEADER_PAGE_DATA_SIZE,
+        .end = SWAP_SIZE - FLASH_PAGE_SIZE,
+        .policy = REGION_DIRECT,
+        .dev = SWAP_DEVICE,
+        .offset = SWAP_ADDRESS(HEADER_PAGE_DATA_SIZE),
+        .area = FOTA_STATS_BODY
+    },
+    {
+        .start = SWAP_SIZE - FLASH_PAGE_SIZE,
+        .end = SWAP_SIZE,
+        .policy = REGION_MIRROR,
+        .dev = IMAGE_TRAILER_PAGE_DEVICE,
+        .offset = IMAGE_TRAILER_PAGE_OFFSET,
+        .area = FOTA_STATS_TRAILER_MIRROR
+    },
+};
+
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+static const struct fota_region second_slot_regions[] = {
+    {
+        .start = 0,
+        .end = SECOND_SLOT_DATA_SIZE,
+        .policy = REGION_DIRECT,
+        .dev = SECOND_SLOT_DEVICE,
+        .offset = SECOND_SLOT_DATA_OFFSET,
+        .area = FOTA_STATS_BODY
+    },
+};
+#endif
+
+/*
+ * A FOTA slot. Every fragment is written to dev at offset plus the slot
+ * address, the regions add backup copies and decide where reads go.
+ */
+struct fota_slot {
+    uint32_t size;
+    const struct device *dev;
+    off_t offset;
+    const struct device *header_dev;
+    off_t header_offset;
+    const struct fota_region *regions;
+    size_t region_count;
+};
+
+static const struct fota_slot slots[] = {
+    {
+        .size = SWAP_SIZE,
+        .dev = SWAP_DEVICE,
+        .offset = SWAP_OFFSET,
+        .header_dev = IMAGE_HEADER_PAGE_DEVICE,
+        .header_offset = HEADER_PAGE_ADDRESS(MIRA_HEADER_LOCATION),
+        .regions = slot0_regions,
+        .region_count = ARRAY_SIZE(slot0_regions)
+    },
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+    {
+        .size = SECOND_SLOT_DATA_SIZE,
+        .dev = SECOND_SLOT_DEVICE,
+        .offset = SECOND_SLOT_DATA_OFFSET,
+        .header_dev = SECOND_SLOT_DEVICE,
+        .header_offset = SECOND_SLOT_OFFSET,
+        .regions = second_slot_regions,
+        .region_count = ARRAY_SIZE(second_slot_regions)
+    },
+#endif
+};
+
+/* Slot 0 has the most regions, which bounds the segments of a request */
+#define MAX_SEGMENTS ARRAY_SIZE(slot0_regions)
+
+static const struct fota_slot *fota_slot_get(
+    uint16_t slot_id)
+{
+    if (slot_id >= ARRAY_SIZE(slots)) {
+        return NULL;
+    }
+    return &slots[slot_id];
+}
+
+static bool fota_slot_range_valid(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length)
+{
+    const struct fota_slot *slot = fota_slot_get(slot_id);
+    return slot != NULL && address + length <= slot->size;
+}
+
 static int fota_driver_get_size(
     uint16_t slot_id,
     uint32_t *size,
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0) {
+    const struct fota_slot *slot = fota_slot_get(slot_id);
+    if (slot != NULL) {
         // The driver has its own functions to read/write the
-        // mira-fota-header and the header is stored in an otherwise
-        // unused part of the first page.
-        // This makes the whole swap area's size available:
-        *size = (uint32_t) SWAP_SIZE;
-        LOG_DBG("Slot 0 size: %d", SWAP_SIZE);
+        // mira-fota-header and the header is stored outside the slot
+        // data, in an otherwise unused part of the first page for slot 0.
+        // This makes the whole data area's size available:
+        *size = slot->size;
+        LOG_DBG("Slot %d size: %d", slot_id, slot->size);
         done_callback(storage);
         return 0;
     } else {
@@ -95,31 +503,214 @@ static int fota_driver_get_size(
     }
 }
 
-static bool is_overlapping_mira_fota_header(
+/*
+ * Part of a request served by one flash call, or by a 0xFF fill when dev
+ * is NULL. pos is the position in the caller's buffer.
+ */
+struct fota_segment {
+    const struct device *dev;
+    off_t offset;
+    uint32_t pos;
+    uint32_t length;
+    enum fota_stats_area area;
+};
+
+/*
+ * Split a request into the segments of the regions it covers, merging
+ * neighbours that continue on the same device. With write set, only the
+ * backing page copies are collected, the SWAP part is a single write.
+ */
+static size_t fota_segments_build(
+    const struct fota_region *regions,
+    size_t region_count,
+    uint32_t address,
+    uint32_t length,
+    bool write,
+    struct fota_segment *segments)
+{
+    size_t count = 0;
+    uint32_t pos = 0;
+    uint32_t end = address + length;
+    for (size_t i = 0; i < region_count && address < end; i++) {
+        const struct fota_region *region = &regions[i];
+        if (region->end <= address) {
+            continue;
+        }
+        uint32_t seg_length = MIN(end, region->end) - address;
+        const struct device *dev = region->dev;
+        off_t offset = region->offset + (address - region->start);
+        if (write && region->policy != REGION_MIRROR) {
+            address += seg_length;
+            pos += seg_length;
+            continue;
+        }
+        if (region->policy == REGION_MASK) {
+            dev = NULL;
+            offset = 0;
+        }
+        struct fota_segment *prev = count > 0 ? &segments[count - 1] : NULL;
+        if (prev != NULL
+            && prev->dev == dev
+            && prev->area == region->area
+            && prev->pos + prev->length == pos
+            && (dev == NULL || prev->offset + prev->length == offset)) {
+            prev->length += seg_length;
+        } else {
+            segments[count++] = (struct fota_segment) {
+                .dev = dev,
+                .offset = offset,
+                .pos = pos,
+                .length = seg_length,
+                .area = region->area
+            };
+        }
+        address += seg_length;
+        pos += seg_length;
+    }
+    return count;
+}
+
+#if CONFIG_MIRA_FOTA_MMAP_READ
+#define INTERNAL_FLASH_NODE DT_CHOSEN(zephyr_flash)
+
+/*
+ * CPU address of offset 0 of a flash device, or NULL when the device is
+ * not memory-mapped and has to be read through the flash driver.
+ */
+static const uint8_t *flash_mapped_base(
+    const struct device *dev)
+{
+    if (dev != DEVICE_DT_GET(DT_PARENT(INTERNAL_FLASH_NODE))) {
+        return NULL;
+    }
+#if CONFIG_FLASH_SIMULATOR
+    size_t size;
+    return flash_simulator_get_memory(dev, &size);
+#else
+    return (const uint8_t *) DT_REG_ADDR(INTERNAL_FLASH_NODE);
+#endif
+}
+#endif
+
+static int fota_segments_read(
+    const struct fota_slot *slot,
+    uint8_t *data,
     uint32_t address,
     uint32_t length)
 {
-    if ((address + length <= MIRA_HEADER_LOCATION)
-        || (address >= MIRA_HEADER_LOCATION + MIRA_FOTA_HEADER_SIZE)) {
-        return false;
-    } else {
-        return true;
+    struct fota_segment segments[MAX_SEGMENTS];
+    size_t count = fota_segments_build(slot->regions,
+        slot->region_count,
+        address,
+        length,
+        false,
+        segments);
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].dev == NULL) {
+            memset(&data[segments[i].pos], 0xff, segments[i].length);
+            continue;
+        }
+#if CONFIG_MIRA_FOTA_MMAP_READ
+        const uint8_t *mapped = flash_mapped_base(segments[i].dev);
+        if (mapped != NULL) {
+            uint32_t begin = fota_stats_begin();
+            memcpy(&data[segments[i].pos],
+                mapped + segments[i].offset,
+                segments[i].length);
+            fota_stats_end(FOTA_STATS_READ, segments[i].area, begin,
+                segments[i].length, 0);
+            continue;
+        }
+#endif
+        int ret = fota_flash_read(segments[i].dev,
+            segments[i].offset,
+            &data[segments[i].pos],
+            segments[i].length,
+            FOTA_STATS_READ,
+            segments[i].area);
+        if (ret != 0) {
+            return ret;
+        }
     }
+    return 0;
 }
 
-static uint32_t length_before_mira_header(
+static int fota_segments_write(
+    const struct fota_slot *slot,
+    const uint8_t *data,
     uint32_t address,
     uint32_t length)
 {
-    return MIRA_HEADER_LOCATION - address;
+    struct fota_segment segments[MAX_SEGMENTS];
+    size_t count = fota_segments_build(slot->regions,
+        slot->region_count,
+        address,
+        length,
+        true,
+        segments);
+    int ret = fota_flash_write(slot->dev, slot->offset + address, data, length,
+        FOTA_STATS_WRITE, FOTA_STATS_BODY);
+    for (size_t i = 0; i < count && ret == 0; i++) {
+        ret = fota_flash_write(segments[i].dev,
+            segments[i].offset,
+            &data[segments[i].pos],
+            segments[i].length,
+            FOTA_STATS_WRITE,
+            segments[i].area);
+    }
+    return ret;
 }
 
-static uint32_t length_after_mira_header(
+/* Read slot data as stored in flash, written fragments only */
+static int fota_driver_read_slot(
+    uint16_t slot_id,
+    void *data,
     uint32_t address,
     uint32_t length)
 {
-    return (address + length) - MCU_BOOT_HEADER_LOCATION;
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    if (slot_id == 0 && fill_stale_pages(data, address, length)) {
+        LOG_DBG("Read from stale pages, addr: %d, length: %d", address, length);
+        return 0;
+    }
+#endif
+    int ret = fota_segments_read(fota_slot_get(slot_id), data, address, length);
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    if (slot_id == 0) {
+        /* Only part of the range was stale, the flash reads overwrote it */
+        fill_stale_pages(data, address, length);
+    }
+#endif
+    return ret;
+}
+
+#if CONFIG_MIRA_FOTA_READ_CACHE
+/*
+ * Cache blocks are larger than the request, flush queued and buffered
+ * data in them
+ */
+static int fota_driver_cache_fill(
+    uint16_t slot_id,
+    void *data,
+    uint32_t address,
+    uint32_t length)
+{
+    int ret = 0;
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+    ret = fota_write_queue_flush_range(slot_id, address, length);
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+    ret = fota_write_combine_flush_range(slot_id, address, length);
+#endif
+    if (ret != 0) {
+        return ret;
+    }
+    return fota_driver_read_slot(slot_id, data, address, length);
 }
+#endif
+
+/* Image fragments written by MiraMesh, see fota_driver_transfer_activity */
+static atomic_t transfer_activity;
 
 static int fota_driver_read(
     uint16_t slot_id,
@@ -129,83 +720,35 @@ static int fota_driver_read(
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0
-        && ((address + length) <= SWAP_SIZE)) {
-        uint8_t *img_fragment = data;
-        const struct device *swap_dev = SWAP_DEVICE;
-        if (address_in_header_page(address)) {
-            const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
-            uint32_t overlap = flash_check_overlapping(address, length);
-            if (overlap == 0) {
-                LOG_DBG("Read from slot 0, header, addr: %d, length: %d",
-                    address,
-                    length);
-                if (is_overlapping_mira_fota_header(address, length)) {
-                    flash_read(header_dev,
-                        HEADER_PAGE_ADDRESS(address),
-                        img_fragment,
-                        length);
-                    for (uint32_t i = 0; i < length; i++) {
-                        if (is_overlapping_mira_fota_header(address + i, 1)) {
-                            img_fragment[i] = 0xff;
-                        }
-                    }
-
-                } else {
-                    flash_read(header_dev,
-                        HEADER_PAGE_ADDRESS(address),
-                        img_fragment,
-                        length);
-                }
-            } else {
-                LOG_DBG(
-                    "Read from slot 0, header overlapping, addr: %d, length: %d",
-                    address,
-                    length);
-                uint32_t length_in_header = length - overlap;
-                LOG_DBG("Reading from header, address: %d, length: %d",
-                    address,
-                    length_in_header);
-                flash_read(header_dev,
-                    HEADER_PAGE_ADDRESS(address),
-                    data,
-                    length_in_header);
-                img_fragment += length_in_header;
-                flash_read(swap_dev,
-                    SWAP_ADDRESS(HEADER_PAGE_DATA_SIZE),
-                    img_fragment,
-                    overlap);
-            }
-        } else if (address_in_trailer_page(address, length)) {
-            const struct device *trailer_dev = IMAGE_TRAILER_PAGE_DEVICE;
-            uint32_t overlap = flash_check_overlapping(address, length);
-            if (overlap == 0) {
-                LOG_DBG("Read from slot 0, trailer, addr: %d, length: %d",
-                    address,
-                    length);
-                flash_read(trailer_dev,
-                    TRAILER_PAGE_ADDRESS(address),
-                    img_fragment,
-                    length);
-            } else {
-                LOG_DBG(
-                    "Read from slot 0, trailer, overlapping addr: %d, length: %d",
-                    address,
-                    length);
-                uint32_t length_in_swap = length - overlap;
-                flash_read(swap_dev,
-                    SWAP_ADDRESS(address),
-                    img_fragment,
-                    length_in_swap);
-                img_fragment += length_in_swap;
-                flash_read(trailer_dev,
-                    TRAILER_PAGE_ADDRESS(address + length_in_swap),
-                    img_fragment,
-                    overlap);
-            }
-        } else {
-            LOG_DBG("Read from slot 0, addr: %d, length: %d", address, length);
-            flash_read(swap_dev, SWAP_ADDRESS(address), img_fragment, length);
+    if (fota_slot_range_valid(slot_id, address, length)) {
+        int ret = 0;
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+        /*
+         * Only the fragments being read are waited for. Data of an image
+         * with a failed write is not passed on.
+         */
+        ret = fota_write_queue_flush_range(slot_id, address, length);
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+        if (ret == 0) {
+            ret = fota_write_combine_flush_range(slot_id, address, length);
+        }
+#endif
+        LOG_DBG("Read from slot %d, addr: %d, length: %d", slot_id, address, length);
+        if (ret == 0) {
+#if CONFIG_MIRA_FOTA_READ_CACHE
+            ret = fota_read_cache_read(slot_id,
+                fota_slot_get(slot_id)->size,
+                data,
+                address,
+                length);
+#else
+            ret = fota_driver_read_slot(slot_id, data, address, length);
+#endif
+        }
+        if (ret != 0) {
+            LOG_ERR("Read from slot %d at %u failed: %d", slot_id, address, ret);
+            return -1;
         }
         done_callback(storage);
         return 0;
@@ -215,6 +758,44 @@ static int fota_driver_read(
     }
 }
 
+static int fota_driver_write_fragment(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length)
+{
+    int ret = 0;
+    if (slot_id == 0) {
+        ret = prepare_pages_for_write(address, length);
+        mark_written(address, length);
+    }
+    LOG_DBG("Write to slot %d, offset: %d, length: %d", slot_id, address, length);
+    if (ret == 0) {
+        ret = fota_segments_write(fota_slot_get(slot_id), data, address, length);
+    }
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    fota_read_cache_invalidate(slot_id, address, length);
+#endif
+    return ret;
+}
+
+/*
+ * Entry point for fragment writes, goes through the page buffer when
+ * write combining is enabled.
+ */
+static int fota_driver_store_fragment(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length)
+{
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+    return fota_write_combine_write(slot_id, data, address, length);
+#else
+    return fota_driver_write_fragment(slot_id, data, address, length);
+#endif
+}
+
 static int fota_driver_write(
     uint16_t slot_id,
     const void *data,
@@ -223,94 +804,25 @@ static int fota_driver_write(
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0
-        && ((address + length) <= SWAP_SIZE)) {
-        const uint8_t *img_fragment = data;
-        const struct device *swap_dev = SWAP_DEVICE;
-        if (address_in_header_page(address)) {
-            const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
-            uint32_t overlap = flash_check_overlapping(address, length);
-            if (overlap == 0) {
-                if (is_overlapping_mira_fota_header(address, length)) {
-                    uint32_t before = length_before_mira_header(address, length);
-                    uint32_t after = length_after_mira_header(address, length);
-                    if (before != 0) {
-                        flash_write(header_dev,
-                            HEADER_PAGE_ADDRESS(address),
-                            img_fragment,
-                            before);
-                    }
-
-                    if (after != 0) {
-                        flash_write(header_dev,
-                            HEADER_PAGE_ADDRESS(address + before
-                                + MIRA_FOTA_HEADER_SIZE),
-                            &img_fragment[before + MIRA_FOTA_HEADER_SIZE],
-                            after);
-                    }
-
-                    flash_write(swap_dev,
-                        SWAP_ADDRESS(address),
-                        img_fragment,
-                        length);
-
-                } else {
-                    LOG_DBG("Write to slot 0, header, offset: %d, length: %d",
-                        address,
-                        length);
-                    flash_write(swap_dev,
-                        SWAP_ADDRESS(address),
-                        img_fragment,
-                        length);
-                    LOG_DBG("Write to: %u, length: %u", address, length);
-                    flash_write(header_dev,
-                        HEADER_PAGE_ADDRESS(address),
-                        img_fragment,
-                        length);
-                }
-            } else {
-                LOG_DBG("Write to slot 0, header, offset: %d, length: %d",
-                    address,
-                    length);
-                flash_write(swap_dev, SWAP_ADDRESS(address), img_fragment, length);
-                uint32_t length_in_header = length - overlap;
-                flash_write(
-                    header_dev,
-                    HEADER_PAGE_ADDRESS(address),
-                    img_fragment,
-                    length_in_header);
-            }
-        } else if (address_in_trailer_page(address, length)) {
-            const struct device *trailer_dev = IMAGE_TRAILER_PAGE_DEVICE;
-            uint32_t overlap = flash_check_overlapping(address, length);
-            if (overlap == 0) {
-                LOG_DBG("Write to slot 0, trailer, offset: %d, length: %d",
-                    address,
-                    length);
-                flash_write(swap_dev, SWAP_ADDRESS(address), img_fragment, length);
-                flash_write(trailer_dev,
-                    TRAILER_PAGE_ADDRESS(address),
-                    img_fragment,
-                    length);
-            } else {
-                LOG_DBG(
-                    "Write to slot 0, trailer overlapping, offset: %d, length: %d",
-                    address,
-                    length);
-                flash_write(swap_dev, SWAP_ADDRESS(address), img_fragment, length);
-                uint32_t length_in_swap = length - overlap;
-                img_fragment += length_in_swap;
-                LOG_DBG("length_in_swap: %u, overlap: %u", length_in_swap, overlap);
-                flash_write(trailer_dev,
-                    TRAILER_PAGE_ADDRESS(address + length_in_swap),
-                    img_fragment,
-                    overlap);
-            }
-        } else {
-            LOG_DBG("Write to slot 0, offset: %d, length: %d", address, length);
-            flash_write(swap_dev, SWAP_ADDRESS(address), img_fragment, length);
+    if (fota_slot_range_valid(slot_id, address, length)) {
+        atomic_inc(&transfer_activity);
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+        int ret = fota_write_queue_submit(slot_id,
+            data,
+            address,
+            length,
+            done_callback,
+            storage);
+#else
+        int ret = fota_driver_store_fragment(slot_id, data, address, length);
+        if (ret == 0) {
+            done_callback(storage);
+        }
+#endif
+        if (ret != 0) {
+            LOG_ERR("Write to slot %d at %u failed: %d", slot_id, address, ret);
+            return -1;
         }
-        done_callback(storage);
         return 0;
     } else {
         LOG_DBG("Slot %d not available or length out of bounds", slot_id);
@@ -318,23 +830,42 @@ static int fota_driver_write(
     }
 }
 
+uint32_t fota_driver_transfer_activity(
+    void)
+{
+    return atomic_get(&transfer_activity);
+}
+
 static int fota_driver_read_header(
     uint16_t slot_id,
     void *data,
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0) {
+    const struct fota_slot *slot = fota_slot_get(slot_id);
+    if (slot != NULL) {
         uint8_t *img_fragment = data;
-        const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
         LOG_DBG(
-            "Read from slot 0, Mira header, addr: %d, length: %d",
-            MIRA_HEADER_LOCATION,
+            "Read from slot %d, Mira header, offset: 0x%x, length: %d",
+            slot_id,
+            (uint32_t) slot->header_offset,
             MIRA_FOTA_HEADER_SIZE);
-        flash_read(header_dev,
-            HEADER_PAGE_ADDRESS(MIRA_HEADER_LOCATION),
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+        /* Like the slot data, a stale header reads as erased */
+        if (slot_id == 0 && atomic_test_bit(stale_pages, HEADER_BACKUP_PAGE_INDEX)) {
+            memset(img_fragment, 0xff, MIRA_FOTA_HEADER_SIZE);
+            done_callback(storage);
+            return 0;
+        }
+#endif
+        if (fota_flash_read(slot->header_dev,
+            slot->header_offset,
             img_fragment,
-            MIRA_FOTA_HEADER_SIZE);
+            MIRA_FOTA_HEADER_SIZE,
+            FOTA_STATS_HEADER_READ,
+            slot_id == 0 ? FOTA_STATS_HEADER_MIRROR : FOTA_STATS_BODY) != 0) {
+            return -1;
+        }
         done_callback(storage);
         return 0;
     } else {
@@ -349,17 +880,42 @@ static int fota_driver_write_header(
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0) {
+    const struct fota_slot *slot = fota_slot_get(slot_id);
+    if (slot != NULL) {
+        /* An image missing a fragment must not get a valid header */
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+        if (fota_write_queue_flush() != 0) {
+            return -1;
+        }
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+        if (fota_write_combine_flush() != 0) {
+            return -1;
+        }
+#endif
         const uint8_t *img_fragment = data;
-        const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
         LOG_DBG(
-            "Write to slot 0, Mira header, addr: %d, length: %d",
-            MIRA_HEADER_LOCATION,
+            "Write to slot %d, Mira header, offset: 0x%x, length: %d",
+            slot_id,
+            (uint32_t) slot->header_offset,
             MIRA_FOTA_HEADER_SIZE);
-        flash_write(header_dev,
-            HEADER_PAGE_ADDRESS(MIRA_HEADER_LOCATION),
+        if (slot_id == 0) {
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+            if (erase_if_stale(slot->header_dev, IMAGE_HEADER_PAGE_OFFSET,
+                HEADER_BACKUP_PAGE_INDEX) != 0) {
+                return -1;
+            }
+#endif
+            atomic_set_bit(written_pages, HEADER_BACKUP_PAGE_INDEX);
+        }
+        if (fota_flash_write(slot->header_dev,
+            slot->header_offset,
             img_fragment,
-            MIRA_FOTA_HEADER_SIZE);
+            MIRA_FOTA_HEADER_SIZE,
+            FOTA_STATS_HEADER_WRITE,
+            slot_id == 0 ? FOTA_STATS_HEADER_MIRROR : FOTA_STATS_BODY) != 0) {
+            return -1;
+        }
         done_callback(storage);
         return 0;
     } else {
@@ -371,28 +927,140 @@ static int fota_driver_write_header(
 static void (*done_callback_erase)(
     void *storage) = NULL;
 static void *storage_erase = NULL;
+static uint16_t erase_slot_id;
+
+struct erase_run {
+    uint32_t pages;
+    uint32_t errors;
+    uint32_t longest_ms;
+    uint32_t paced_ms;
+};
+
+/*
+ * Give the radio time between page erases. With MPSL the flash driver
+ * runs erases in radio timeslots, so an erase taking longer than
+ * nominal has been waiting for the radio.
+ */
+static void erase_pace(
+    uint32_t duration_ms,
+    struct erase_run *run)
+{
+    uint32_t sleep_ms = 0;
+#if CONFIG_MIRA_FOTA_ERASE_PACING_FIXED
+    sleep_ms = CONFIG_MIRA_FOTA_ERASE_PACING_FIXED_MS;
+#elif CONFIG_MIRA_FOTA_ERASE_PACING_ADAPTIVE
+    uint32_t waited_ms = 0;
+    if (duration_ms > CONFIG_MIRA_FOTA_ERASE_PACING_NOMINAL_MS) {
+        waited_ms = duration_ms - CONFIG_MIRA_FOTA_ERASE_PACING_NOMINAL_MS;
+    }
+    sleep_ms = CLAMP(waited_ms,
+        CONFIG_MIRA_FOTA_ERASE_PACING_MIN_MS,
+        CONFIG_MIRA_FOTA_ERASE_PACING_MAX_MS);
+#endif
+    if (sleep_ms != 0) {
+        k_sleep(K_MSEC(sleep_ms));
+        run->paced_ms += sleep_ms;
+    }
+}
+
+static void erase_page(
+    const struct device *dev,
+    off_t offset,
+    enum fota_stats_area area,
+    struct erase_run *run)
+{
+    int64_t start = k_uptime_get();
+    if (fota_flash_erase(dev, offset, area) != 0) {
+        run->errors++;
+    }
+    uint32_t duration_ms = k_uptime_get() - start;
+    LOG_DBG("Erased page at 0x%x in %u ms", (uint32_t) offset, duration_ms);
+    run->pages++;
+    run->longest_ms = MAX(run->longest_ms, duration_ms);
+    erase_pace(duration_ms, run);
+}
+
+/* Erase the SWAP partition and the backup pages, returns the page count */
+static uint32_t erase_swap(
+    struct erase_run *run)
+{
+    const struct device *swap_dev = SWAP_DEVICE;
+    for (int i = 0; i < SWAP_PAGE_COUNT; i++) {
+        if (page_needs_erase(swap_dev, SWAP_ADDRESS(FLASH_PAGE_SIZE * i), i)) {
+            erase_page(swap_dev, SWAP_ADDRESS(FLASH_PAGE_SIZE * i),
+                FOTA_STATS_BODY, run);
+        }
+    }
+    const struct device *trailer_dev = IMAGE_TRAILER_PAGE_DEVICE;
+    if (page_needs_erase(trailer_dev, IMAGE_TRAILER_PAGE_OFFSET,
+        TRAILER_BACKUP_PAGE_INDEX)) {
+        erase_page(trailer_dev, IMAGE_TRAILER_PAGE_OFFSET,
+            FOTA_STATS_TRAILER_MIRROR, run);
+    }
+    const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
+    if (page_needs_erase(header_dev, HEADER_PAGE_ADDRESS(0),
+        HEADER_BACKUP_PAGE_INDEX)) {
+        erase_page(header_dev, HEADER_PAGE_ADDRESS(0),
+            FOTA_STATS_HEADER_MIRROR, run);
+    }
+    written_pages_known = true;
+    return TRACKED_PAGE_COUNT;
+}
+
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+/*
+ * Erase the second slot, header page included. Writes to it are not
+ * tracked, pages that are already blank are skipped.
+ */
+static uint32_t erase_second_slot(
+    struct erase_run *run)
+{
+    const struct device *dev = SECOND_SLOT_DEVICE;
+    uint32_t page_count = SECOND_SLOT_SIZE / FLASH_PAGE_SIZE;
+    for (uint32_t i = 0; i < page_count; i++) {
+        off_t offset = SECOND_SLOT_OFFSET + FLASH_PAGE_SIZE * i;
+        if (!page_is_blank(dev, offset, FOTA_STATS_BODY)) {
+            erase_page(dev, offset, FOTA_STATS_BODY, run);
+        }
+    }
+    return page_count;
+}
+#endif
 
 void fota_swap_erase_worker(
     void)
 {
     k_thread_suspend(fota_swap_erase_worker_thread_id);
 
-    const struct device *swap_dev = SWAP_DEVICE;
     while (1) {
-        for (int i = 0; i < SWAP_SIZE / FLASH_PAGE_SIZE; i++) {
-            flash_erase(swap_dev, SWAP_ADDRESS(FLASH_PAGE_SIZE * i),
-                FLASH_PAGE_SIZE);
-#if defined(CONFIG_SOC_SERIES_NRF52X)
-            k_sleep(K_MSEC(100));
+        struct erase_run run = {
+            0
+        };
+        uint32_t page_count;
+        int64_t start = k_uptime_get();
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+        if (erase_slot_id == FOTA_SECOND_SLOT_ID) {
+            page_count = erase_second_slot(&run);
+        } else {
+            page_count = erase_swap(&run);
+        }
+#else
+        page_count = erase_swap(&run);
 #endif
+        LOG_INF("Erased %u of %u pages of slot %d in %u ms (longest %u ms, paced %u ms)",
+            run.pages,
+            page_count,
+            erase_slot_id,
+            (uint32_t) (k_uptime_get() - start),
+            run.longest_ms,
+            run.paced_ms);
+        if (run.errors != 0) {
+            LOG_ERR("%u page erases of slot %d failed", run.errors, erase_slot_id);
         }
-        const struct device *trailer_dev = IMAGE_TRAILER_PAGE_DEVICE;
-        flash_erase(trailer_dev, TRAILER_PAGE_ADDRESS(0), FLASH_PAGE_SIZE);
-#if defined(CONFIG_SOC_SERIES_NRF52X)
-        k_sleep(K_MSEC(100));
+#if CONFIG_MIRA_FOTA_READ_CACHE
+        /* Reads during the erase may have cached pages not erased yet */
+        fota_read_cache_invalidate_slot(erase_slot_id);
 #endif
-        const struct device *header_dev = IMAGE_HEADER_PAGE_DEVICE;
-        flash_erase(header_dev, HEADER_PAGE_ADDRESS(0), FLASH_PAGE_SIZE);
         if (done_callback_erase != NULL && storage_erase != NULL) {
             done_callback_erase(storage_erase);
         }
@@ -417,11 +1085,65 @@ static int fota_driver_erase(
     void (*done_callback)(void *storage),
     void *storage)
 {
-    if (slot_id == 0) {
+    if (fota_slot_get(slot_id) != NULL) {
         LOG_DBG("Erasing slot: %d", slot_id);
-        k_thread_resume(fota_swap_erase_worker_thread_id);
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+        /* A failed write does not matter once its image is erased */
+        fota_write_queue_flush();
+        fota_write_queue_reset(slot_id);
+
+        struct fota_write_queue_stats stats;
+        fota_write_queue_get_stats(&stats);
+        LOG_INF("Write queue: %u writes, max depth %u, %u held, %u rejected",
+            stats.submitted,
+            stats.max_depth,
+            stats.held,
+            stats.rejected);
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+        /* Buffered data belongs to the image being erased */
+        fota_write_combine_discard(slot_id);
+
+        struct fota_write_combine_stats combine_stats;
+        fota_write_combine_get_stats(&combine_stats);
+        LOG_INF("Write combining: %u fragments, %u page, %u partial, %u direct",
+            combine_stats.fragments,
+            combine_stats.page_flushes,
+            combine_stats.partial_flushes,
+            combine_stats.direct_writes);
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+        fota_read_cache_invalidate_slot(slot_id);
+
+        struct fota_read_cache_stats cache_stats;
+        fota_read_cache_get_stats(&cache_stats);
+        LOG_INF("Read cache: %u hits, %u misses, %u read ahead, %u invalidated",
+            cache_stats.hits,
+            cache_stats.misses,
+            cache_stats.readahead,
+            cache_stats.invalidations);
+#endif
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+        if (slot_id == 0) {
+            /*
+             * Writes of an interrupted transfer are in flash by now, marking
+             * every page stale again restarts the slot from scratch. Only
+             * the header backup page is erased before returning.
+             */
+            LOG_INF("Lazily erased %u pages since last erase", lazy_erased_pages);
+            lazy_erased_pages = 0;
+            if (mark_all_stale() != 0) {
+                return -1;
+            }
+            done_callback(storage);
+            return 0;
+        }
+#endif
+        /* The worker picks these up as soon as it is resumed */
+        erase_slot_id = slot_id;
         done_callback_erase = done_callback;
         storage_erase = storage;
+        k_thread_resume(fota_swap_erase_worker_thread_id);
         return 0;
     } else {
         LOG_DBG("Slot %d not available", slot_id);
@@ -432,7 +1154,16 @@ static int fota_driver_erase(
 void fota_driver_init(
     void)
 {
-    /* Nothing special needs to be done here */
+    fota_stats_init();
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+    fota_write_combine_init(fota_driver_write_fragment);
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+    fota_write_queue_init(fota_driver_store_fragment);
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    fota_read_cache_init(fota_driver_cache_fill);
+#endif
 }
 
 void fota_driver_set_custom_driver(
@@ -453,57 +1184,393 @@ void fota_driver_set_custom_driver(
 }
 
 static uint8_t flash_page_cache[FLASH_PAGE_SIZE];
-void fota_driver_copy_trailer_page(
+int fota_driver_copy_trailer_page(
     void)
 {
     const struct device *swap_dev = SWAP_DEVICE;
     const struct device *trailer_dev = IMAGE_TRAILER_PAGE_DEVICE;
-    flash_read(swap_dev,
+    int ret = fota_flash_read(swap_dev,
         SWAP_OFFSET + SWAP_SIZE - FLASH_PAGE_SIZE,
         flash_page_cache,
-        FLASH_PAGE_SIZE);
-    flash_write(trailer_dev, IMAGE_TRAILER_PAGE_OFFSET, flash_page_cache,
-        IMAGE_TRAILER_PAGE_SIZE);
+        FLASH_PAGE_SIZE,
+        FOTA_STATS_READ,
+        FOTA_STATS_BODY);
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    if (ret == 0) {
+        ret = erase_if_stale(trailer_dev, IMAGE_TRAILER_PAGE_OFFSET,
+            TRAILER_BACKUP_PAGE_INDEX);
+    }
+#endif
+    if (ret == 0) {
+        atomic_set_bit(written_pages, TRAILER_BACKUP_PAGE_INDEX);
+        ret = fota_flash_write(trailer_dev, IMAGE_TRAILER_PAGE_OFFSET, flash_page_cache,
+            IMAGE_TRAILER_PAGE_SIZE, FOTA_STATS_WRITE, FOTA_STATS_TRAILER_MIRROR);
+#if CONFIG_MIRA_FOTA_READ_CACHE
+        fota_read_cache_invalidate(FOTA_SLOT_ID, SWAP_SIZE - FLASH_PAGE_SIZE,
+            FLASH_PAGE_SIZE);
+#endif
+    }
+    return ret;
 }
 
-void fota_driver_copy_header_page(
+int fota_driver_copy_header_page(
     void)
 {
     const struct device *swap_dev = SWAP_DEVICE;
     const struct device *trailer_dev = IMAGE_HEADER_PAGE_DEVICE;
-    flash_read(swap_dev, SWAP_OFFSET, flash_page_cache, FLASH_PAGE_SIZE);
-    flash_write(trailer_dev,
-        IMAGE_HEADER_PAGE_OFFSET,
-        flash_page_cache,
-        IMAGE_HEADER_PAGE_SIZE);
+    int ret = fota_flash_read(swap_dev, SWAP_OFFSET, flash_page_cache, FLASH_PAGE_SIZE,
+        FOTA_STATS_READ, FOTA_STATS_BODY);
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    if (ret == 0) {
+        ret = erase_if_stale(trailer_dev, IMAGE_HEADER_PAGE_OFFSET,
+            HEADER_BACKUP_PAGE_INDEX);
+    }
+#endif
+    if (ret == 0) {
+        atomic_set_bit(written_pages, HEADER_BACKUP_PAGE_INDEX);
+        ret = fota_flash_write(trailer_dev,
+            IMAGE_HEADER_PAGE_OFFSET,
+            flash_page_cache,
+            IMAGE_HEADER_PAGE_SIZE,
+            FOTA_STATS_WRITE,
+            FOTA_STATS_HEADER_MIRROR);
+#if CONFIG_MIRA_FOTA_READ_CACHE
+        fota_read_cache_invalidate(FOTA_SLOT_ID, 0, HEADER_PAGE_DATA_SIZE);
+#endif
+    }
+    return ret;
 }
 
-void fota_driver_write_new_header(
+/* Checksum of the image data received so far, see fota_driver_image_crc_update */
+static mira_crc_ctx_t image_crc_ctx;
+static uint32_t image_crc_length;
+static bool image_crc_tracking = false;
+
+void fota_driver_image_crc_update(
+    uint32_t offset,
+    const void *data,
+    uint32_t length)
+{
+    if (offset == 0) {
+        mira_crc_init(&image_crc_ctx);
+        image_crc_length = 0;
+        image_crc_tracking = true;
+    }
+    if (!image_crc_tracking) {
+        return;
+    }
+    if (offset != image_crc_length || offset + length > SWAP_SIZE) {
+        LOG_DBG("Untracked image chunk at %u, expected %u",
+            offset,
+            image_crc_length);
+        image_crc_tracking = false;
+        return;
+    }
+    mira_crc_update(&image_crc_ctx, data, length);
+    image_crc_length += length;
+}
+
+void fota_driver_image_crc_reset(
     void)
 {
-    mira_crc_ctx_t ctx;
-    mira_crc_init(&ctx);
-    uint8_t buf[32];
+    image_crc_tracking = false;
+}
+
+static int image_crc_update_from_flash(
+    mira_crc_ctx_t *ctx,
+    uint32_t offset)
+{
     const struct device *swap_dev = SWAP_DEVICE;
-    for (int offset = 0; offset < SWAP_SIZE; offset += sizeof(buf)) {
-        flash_read(swap_dev, SWAP_OFFSET + offset, buf, sizeof(buf));
-        mira_crc_update(&ctx, buf, sizeof(buf));
+    while (offset < SWAP_SIZE) {
+        uint32_t length = MIN(CONFIG_MIRA_FOTA_CRC_READ_CHUNK_SIZE,
+            SWAP_SIZE - offset);
+        int ret = fota_flash_read(swap_dev, SWAP_ADDRESS(offset), flash_page_cache,
+            length, FOTA_STATS_READ, FOTA_STATS_BODY);
+        if (ret != 0) {
+            return ret;
+        }
+        mira_crc_update(ctx, flash_page_cache, length);
+        offset += length;
+    }
+    return 0;
+}
+
+static int write_mira_header(
+    uint16_t slot_id,
+    uint32_t size,
+    mira_crc_ctx_t *ctx);
+
+int fota_driver_write_new_header(
+    void)
+{
+    mira_crc_ctx_t ctx;
+    uint32_t tracked_length = 0;
+    if (image_crc_tracking) {
+        ctx = image_crc_ctx;
+        tracked_length = image_crc_length;
+    } else {
+        mira_crc_init(&ctx);
     }
+    image_crc_tracking = false;
+    LOG_DBG("Image checksum tracked for %u bytes, reading %u bytes",
+        tracked_length,
+        SWAP_SIZE - tracked_length);
+    /* Whatever follows the uploaded image is part of the slot too */
+    int ret = image_crc_update_from_flash(&ctx, tracked_length);
+    if (ret != 0) {
+        LOG_ERR("Reading image for checksum failed: %d", ret);
+        return ret;
+    }
+    return write_mira_header(FOTA_SLOT_ID, SWAP_SIZE, &ctx);
+}
+
+static int write_mira_header(
+    uint16_t slot_id,
+    uint32_t size,
+    mira_crc_ctx_t *ctx)
+{
     mira_fota_header_t header = {
         0
     };
-    mira_crc_get(&ctx, &header.checksum);
+    mira_crc_get(ctx, &header.checksum);
     header.flags = 0;
-    header.size = SWAP_SIZE;
+    header.size = size;
     header.type = 0;
     header.version = 100;
     mira_status_t retval;
-    retval = mira_fota_write_start(0);
-    retval = mira_fota_write_header(SWAP_SIZE,
-        header.checksum,
-        header.type,
-        header.flags,
-        header.version);
-    retval = mira_fota_write_end();
+    retval = mira_fota_write_start(slot_id);
+    if (retval == MIRA_SUCCESS) {
+        retval = mira_fota_write_header(size,
+            header.checksum,
+            header.type,
+            header.flags,
+            header.version);
+    }
+    if (retval == MIRA_SUCCESS) {
+        retval = mira_fota_write_end();
+    }
+    return retval;
+}
+#if CONFIG_MIRA_FOTA_COMPRESSED
+static int read_container_header(
+    const struct device *dev,
+    off_t offset,
+    uint8_t *buf,
+    struct fota_decompress_header *header)
+{
+    int ret = fota_flash_read(dev, offset, buf, FOTA_DECOMPRESS_MAX_HEADER_SIZE,
+        FOTA_STATS_READ, FOTA_STATS_BODY);
+    if (ret != 0) {
+        return ret;
+    }
+    return fota_decompress_parse_header(buf, header);
+}
+
+int fota_driver_stage_compressed_upload(
+    void)
+{
+    uint8_t buf[FOTA_DECOMPRESS_MAX_HEADER_SIZE];
+    struct fota_decompress_header header;
+    int ret = read_container_header(SWAP_DEVICE, SWAP_OFFSET, buf, &header);
+    if (ret != 0) {
+        return ret;
+    }
+    uint32_t size = header.stream_offset + header.stream_size;
+    if (size > SECOND_SLOT_DATA_SIZE) {
+        LOG_ERR("Compressed image of %u bytes does not fit the second slot", size);
+        return -EFBIG;
+    }
+    LOG_INF("Staging %s image, %u bytes expanding to %u",
+        (header.flags & FOTA_DECOMPRESS_FLAG_DELTA) ? "delta" : "compressed",
+        size,
+        header.image_size);
+
+    struct erase_run run = {
+        0
+    };
+    erase_second_slot(&run);
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    fota_read_cache_invalidate_slot(FOTA_SECOND_SLOT_ID);
+#endif
+    if (run.errors != 0) {
+        return -EIO;
+    }
+
+    mira_crc_ctx_t ctx;
+    mira_crc_init(&ctx);
+    for (uint32_t offset = 0; offset < size; offset += FLASH_PAGE_SIZE) {
+        uint32_t length = MIN(FLASH_PAGE_SIZE, size - offset);
+        ret = fota_flash_read(SWAP_DEVICE, SWAP_ADDRESS(offset), flash_page_cache,
+            length, FOTA_STATS_READ, FOTA_STATS_BODY);
+        if (ret == 0) {
+            ret = fota_segments_write(fota_slot_get(FOTA_SECOND_SLOT_ID),
+                flash_page_cache,
+                offset,
+                length);
+        }
+        if (ret != 0) {
+            return ret;
+        }
+        mira_crc_update(&ctx, flash_page_cache, length);
+    }
+    return write_mira_header(FOTA_SECOND_SLOT_ID, size, &ctx);
+}
+
+static int expand_output(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    uint32_t *address = ctx;
+    int ret = fota_driver_write_fragment(FOTA_SLOT_ID, data, *address, length);
+    if (ret != 0) {
+        LOG_ERR("Writing expanded data at %u failed: %d", *address, ret);
+        return ret;
+    }
+    *address += length;
+    return 0;
+}
+
+#if CONFIG_MIRA_FOTA_DELTA
+static int read_base(
+    uint32_t address,
+    uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    if (address + length > BASE_SIZE) {
+        return -EINVAL;
+    }
+    return fota_flash_read(BASE_DEVICE, BASE_OFFSET + address, data, length,
+        FOTA_STATS_READ, FOTA_STATS_BODY);
+}
+
+static int delta_output(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    return fota_delta_feed(ctx, data, length);
+}
+
+/* A delta only applies to the image it was made against */
+static int check_delta_base(
+    const struct fota_delta_header *header)
+{
+    uint8_t hash[FOTA_DELTA_HASH_SIZE];
+    uint32_t size;
+    int ret = fota_delta_image_hash(read_base, NULL, hash, &size);
+    if (ret != 0) {
+        LOG_ERR("No hash of the running image: %d", ret);
+        return ret;
+    }
+    if (size != header->base_size
+        || memcmp(hash, header->base_hash, sizeof(hash)) != 0) {
+        LOG_ERR("Delta image does not apply to the running image");
+        return -EILSEQ;
+    }
+    return 0;
+}
+#endif
+
+int fota_driver_expand_second_slot(
+    void)
+{
+    /* Too large for the stack of the DFU job */
+    static struct fota_decompress dec;
+    uint8_t buf[FOTA_DECOMPRESS_MAX_HEADER_SIZE];
+    struct fota_decompress_header header;
+    int ret = read_container_header(SECOND_SLOT_DEVICE, SECOND_SLOT_DATA_OFFSET,
+        buf, &header);
+    if (ret != 0) {
+        return ret;
+    }
+    uint32_t end = header.stream_offset + header.stream_size;
+    uint32_t image_size = header.image_size;
+#if CONFIG_MIRA_FOTA_DELTA
+    static struct fota_delta delta;
+    struct fota_delta_header delta_header;
+    bool is_delta = header.flags & FOTA_DECOMPRESS_FLAG_DELTA;
+    if (is_delta) {
+        fota_delta_parse_header(&buf[FOTA_DECOMPRESS_CONTAINER_HEADER_SIZE],
+            &delta_header);
+        ret = check_delta_base(&delta_header);
+        if (ret != 0) {
+            return ret;
+        }
+        image_size = delta_header.image_size;
+    }
+#endif
+    if (image_size > SWAP_SIZE || end > SECOND_SLOT_DATA_SIZE) {
+        return -EFBIG;
+    }
+
+#if CONFIG_MIRA_FOTA_WRITE_ASYNC
+    ret = fota_write_queue_flush();
+    if (ret != 0) {
+        return ret;
+    }
+#endif
+#if CONFIG_MIRA_FOTA_WRITE_COMBINE
+    ret = fota_write_combine_flush();
+    if (ret != 0) {
+        return ret;
+    }
+#endif
+    int64_t start = k_uptime_get();
+#if CONFIG_MIRA_FOTA_LAZY_ERASE
+    ret = mark_all_stale();
+    if (ret != 0) {
+        return ret;
+    }
+#else
+    struct erase_run run = {
+        0
+    };
+    erase_swap(&run);
+    if (run.errors != 0) {
+        return -EIO;
+    }
+#endif
+#if CONFIG_MIRA_FOTA_READ_CACHE
+    fota_read_cache_invalidate_slot(FOTA_SLOT_ID);
+#endif
+
+    uint32_t address = 0;
+#if CONFIG_MIRA_FOTA_DELTA
+    if (is_delta) {
+        fota_delta_init(&delta, &delta_header, read_base, expand_output,
+            &address);
+        fota_decompress_init(&dec, &header, delta_output, &delta);
+    } else
+#endif
+    {
+        fota_decompress_init(&dec, &header, expand_output, &address);
+    }
+    for (uint32_t offset = header.stream_offset; offset < end;
+         offset += FLASH_PAGE_SIZE) {
+        uint32_t length = MIN(FLASH_PAGE_SIZE, end - offset);
+        ret = fota_flash_read(SECOND_SLOT_DEVICE, SECOND_SLOT_DATA_OFFSET + offset,
+            flash_page_cache, length, FOTA_STATS_READ, FOTA_STATS_BODY);
+        if (ret == 0) {
+            ret = fota_decompress_feed(&dec, flash_page_cache, length);
+        }
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    ret = fota_decompress_finish(&dec);
+#if CONFIG_MIRA_FOTA_DELTA
+    if (ret == 0 && is_delta) {
+        ret = fota_delta_finish(&delta);
+    }
+#endif
+    LOG_INF("Expanded %u bytes to %u bytes in %u ms: %d",
+        end,
+        address,
+        (uint32_t) (k_uptime_get() - start),
+        ret);
+    return ret;
 }
+#endif /* CONFIG_MIRA_FOTA_COMPRESSED */
 #endif
@@ -1,7 +1,14 @@
 #ifndef FOTA_DRIVER_H
 #define FOTA_DRIVER_H
 
+#include <stdint.h>
+
 #define FOTA_SLOT_ID 0
+#if CONFIG_MIRA_FOTA_SECOND_SLOT
+/* Slot on the fota_second_slot partition, not installed by MCUboot */
+#define FOTA_SECOND_SLOT_ID 1
+#endif
+
 /**
  * Sets this driver as the FOTA driver in MiraMesh.
  *
@@ -10,6 +17,24 @@
 void fota_driver_set_custom_driver(
     void);
 
+/**
+ * Number of image fragments MiraMesh has written since boot.
+ *
+ * A change between two calls means this node is receiving an image.
+ * Reads are not counted, they include relaying an image to other nodes.
+ */
+uint32_t fota_driver_transfer_activity(
+    void);
+
+/**
+ * Tell the driver that the SWAP area is written outside the driver.
+ *
+ * The driver only erases pages it knows are written. After this call,
+ * the next erase checks every page for data instead.
+ */
+void fota_driver_swap_written_externally(
+    void);
+
 /**
  * Make a backup of the first page in the SWAP area.
  *
@@ -19,8 +44,10 @@ void fota_driver_set_custom_driver(
  * If the swap area is updated outside of the driver,
  * ie updated via BLE DFU uploads, the first page needs
  * to be copied to the backup page. This function does that.
+ *
+ * @return 0 on success, negative flash driver error otherwise.
  */
-void fota_driver_copy_header_page(
+int fota_driver_copy_header_page(
     void);
 
 /**
@@ -32,15 +59,69 @@ void fota_driver_copy_header_page(
  * If the swap area is updated outside of the driver,
  * ie updated via BLE DFU uploads, the last page needs
  * to be copied to the backup page. This function does that.
+ *
+ * @return 0 on success, negative flash driver error otherwise.
  */
-void fota_driver_copy_trailer_page(
+int fota_driver_copy_trailer_page(
+    void);
+
+/**
+ * Add a chunk of an image written to the SWAP area outside the driver
+ * to the image checksum.
+ *
+ * A chunk at offset 0 starts a new image. Chunks must follow each
+ * other, otherwise the checksum is computed from flash by
+ * fota_driver_write_new_header instead.
+ */
+void fota_driver_image_crc_update(
+    uint32_t offset,
+    const void *data,
+    uint32_t length);
+
+/**
+ * Drop the checksum collected by fota_driver_image_crc_update.
+ */
+void fota_driver_image_crc_reset(
     void);
 
 /**
  * Create a valid Mira FOTA header for the current image in the SWAP
  * area.
+ *
+ * Uses the checksum collected by fota_driver_image_crc_update for the
+ * start of the slot, and reads the rest of the slot from flash. The
+ * time taken grows with the part of the slot after the image.
+ *
+ * @return 0 on success, flash driver error or mira_status_t otherwise.
+ */
+int fota_driver_write_new_header(
+    void);
+
+#if CONFIG_MIRA_FOTA_COMPRESSED
+/**
+ * Move a compressed container uploaded to the SWAP area to the second
+ * slot, and write a Mira FOTA header for it so MiraMesh distributes it.
+ *
+ * @return 0 on success, -ENOENT if the SWAP area does not hold a
+ *         compressed container, flash driver error or mira_status_t
+ *         otherwise.
+ */
+int fota_driver_stage_compressed_upload(
+    void);
+
+/**
+ * Expand the compressed container in the second slot into the SWAP area,
+ * where MCUboot can install it.
+ *
+ * The SWAP area is erased first, so the image in slot 0 is no longer
+ * valid for MiraMesh afterwards. A delta image is patched against the
+ * running image, and only if that is the image the delta was made for.
+ *
+ * @return 0 on success, -EILSEQ if a delta image does not apply to the
+ *         running image, negative error otherwise.
  */
-void fota_driver_write_new_header(
+int fota_driver_expand_second_slot(
     void);
+#endif
 
 #endif /* FOTA_DRIVER_H */
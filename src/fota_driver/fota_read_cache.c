@@ -0,0 +1,210 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_read_cache.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+#if CONFIG_MIRA_FOTA_LOGGING
+LOG_MODULE_DECLARE(fota_driver, CONFIG_MIRA_FOTA_DRIVER_LOG_LEVEL);
+#else
+LOG_MODULE_DECLARE(fota_driver, 0);
+#endif
+
+#define BLOCK_SIZE CONFIG_MIRA_FOTA_READ_CACHE_BLOCK_SIZE
+#define BLOCK_COUNT CONFIG_MIRA_FOTA_READ_CACHE_BLOCKS
+
+/* Slot sizes are whole flash pages, so blocks never cross the slot end */
+BUILD_ASSERT(IS_POWER_OF_TWO(BLOCK_SIZE), "Block size must be a power of two");
+
+struct cache_block {
+    bool valid;
+    uint16_t slot_id;
+    uint32_t address;
+    /* Value of use_counter when the block was last used */
+    uint32_t last_used;
+    uint8_t data[BLOCK_SIZE];
+};
+
+static K_MUTEX_DEFINE(cache_lock);
+
+static fota_read_cache_fill_fn fill;
+static struct fota_read_cache_stats stats;
+
+static struct cache_block blocks[BLOCK_COUNT];
+static uint32_t use_counter;
+
+/* Where a sequential reader continues */
+static uint16_t next_slot_id;
+static uint32_t next_address = UINT32_MAX;
+
+static struct cache_block *lookup(
+    uint16_t slot_id,
+    uint32_t address)
+{
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        if (blocks[i].valid
+            && blocks[i].slot_id == slot_id
+            && blocks[i].address == address) {
+            return &blocks[i];
+        }
+    }
+    return NULL;
+}
+
+static struct cache_block *least_recently_used(
+    void)
+{
+    struct cache_block *lru = &blocks[0];
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        if (!blocks[i].valid) {
+            return &blocks[i];
+        }
+        if (blocks[i].last_used < lru->last_used) {
+            lru = &blocks[i];
+        }
+    }
+    return lru;
+}
+
+static int load(
+    uint16_t slot_id,
+    uint32_t address,
+    struct cache_block **out)
+{
+    struct cache_block *block = least_recently_used();
+    block->valid = false;
+    int ret = fill(slot_id, block->data, address, BLOCK_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+    block->valid = true;
+    block->slot_id = slot_id;
+    block->address = address;
+    block->last_used = ++use_counter;
+    *out = block;
+    return 0;
+}
+
+void fota_read_cache_init(
+    fota_read_cache_fill_fn fill_fn)
+{
+    fill = fill_fn;
+}
+
+int fota_read_cache_read(
+    uint16_t slot_id,
+    uint32_t slot_size,
+    void *data,
+    uint32_t address,
+    uint32_t length)
+{
+    uint8_t *out = data;
+    uint32_t end = address + length;
+    bool missed = false;
+    int ret = 0;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    bool sequential = slot_id == next_slot_id && address == next_address;
+
+    while (address < end) {
+        uint32_t block_address = ROUND_DOWN(address, BLOCK_SIZE);
+        uint32_t n = MIN(end, block_address + BLOCK_SIZE) - address;
+        struct cache_block *block = lookup(slot_id, block_address);
+        if (block != NULL) {
+            stats.hits++;
+            block->last_used = ++use_counter;
+        } else {
+            stats.misses++;
+            missed = true;
+            ret = load(slot_id, block_address, &block);
+            if (ret != 0) {
+                break;
+            }
+        }
+        memcpy(out, &block->data[address - block_address], n);
+        out += n;
+        address += n;
+    }
+
+    if (ret == 0) {
+        next_slot_id = slot_id;
+        next_address = end;
+    }
+
+    if (ret == 0 && sequential && missed) {
+        /* Blocks after the one the reader is in */
+        uint32_t ahead = ROUND_UP(end, BLOCK_SIZE);
+        for (int i = 0; i < CONFIG_MIRA_FOTA_READ_CACHE_READAHEAD
+             && ahead + BLOCK_SIZE <= slot_size; i++) {
+            struct cache_block *block;
+            if (lookup(slot_id, ahead) == NULL) {
+                if (load(slot_id, ahead, &block) != 0) {
+                    break;
+                }
+                stats.readahead++;
+            }
+            ahead += BLOCK_SIZE;
+        }
+    }
+    k_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+void fota_read_cache_invalidate(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        if (blocks[i].valid
+            && blocks[i].slot_id == slot_id
+            && address < blocks[i].address + BLOCK_SIZE
+            && address + length > blocks[i].address) {
+            blocks[i].valid = false;
+            stats.invalidations++;
+        }
+    }
+    k_mutex_unlock(&cache_lock);
+}
+
+void fota_read_cache_invalidate_slot(
+    uint16_t slot_id)
+{
+    fota_read_cache_invalidate(slot_id, 0, UINT32_MAX);
+}
+
+void fota_read_cache_get_stats(
+    struct fota_read_cache_stats *out)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&cache_lock);
+}
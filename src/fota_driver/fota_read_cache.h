@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_READ_CACHE_H
+#define FOTA_READ_CACHE_H
+
+#include <stdint.h>
+
+struct fota_read_cache_stats {
+    /* Blocks served from the cache */
+    uint32_t hits;
+    /* Blocks read from flash for a request */
+    uint32_t misses;
+    /* Blocks read from flash ahead of a sequential reader */
+    uint32_t readahead;
+    /* Cached blocks dropped by writes and erases */
+    uint32_t invalidations;
+};
+
+/**
+ * Function reading a block of a slot from flash.
+ */
+typedef int (*fota_read_cache_fill_fn)(
+    uint16_t slot_id,
+    void *data,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Set the function used to read blocks missing in the cache.
+ */
+void fota_read_cache_init(
+    fota_read_cache_fill_fn fill_fn);
+
+/**
+ * Read from a slot through the cache.
+ *
+ * Blocks missing in the cache are read with the fill function. When the
+ * read continues where the previous one ended, the following blocks are
+ * read ahead as well.
+ *
+ * @param slot_size Size of the slot, readahead stops at the end of it.
+ *
+ * @return 0 on success, error from the fill function otherwise.
+ */
+int fota_read_cache_read(
+    uint16_t slot_id,
+    uint32_t slot_size,
+    void *data,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Drop cached blocks overlapping a range written to a slot.
+ */
+void fota_read_cache_invalidate(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Drop all cached blocks of a slot.
+ */
+void fota_read_cache_invalidate_slot(
+    uint16_t slot_id);
+
+void fota_read_cache_get_stats(
+    struct fota_read_cache_stats *stats);
+
+#endif /* FOTA_READ_CACHE_H */
@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_stats.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/stats/stats.h>
+
+STATS_SECT_START(fota_op)
+STATS_SECT_ENTRY32(count)
+STATS_SECT_ENTRY32(errors)
+STATS_SECT_ENTRY32(bytes)
+STATS_SECT_ENTRY32(total_us)
+STATS_SECT_ENTRY32(max_us)
+STATS_SECT_ENTRY32(lt_100us)
+STATS_SECT_ENTRY32(lt_1ms)
+STATS_SECT_ENTRY32(lt_10ms)
+STATS_SECT_ENTRY32(lt_100ms)
+STATS_SECT_ENTRY32(ge_100ms)
+STATS_SECT_END;
+
+STATS_NAME_START(fota_op)
+STATS_NAME(fota_op, count)
+STATS_NAME(fota_op, errors)
+STATS_NAME(fota_op, bytes)
+STATS_NAME(fota_op, total_us)
+STATS_NAME(fota_op, max_us)
+STATS_NAME(fota_op, lt_100us)
+STATS_NAME(fota_op, lt_1ms)
+STATS_NAME(fota_op, lt_10ms)
+STATS_NAME(fota_op, lt_100ms)
+STATS_NAME(fota_op, ge_100ms)
+STATS_NAME_END(fota_op);
+
+STATS_SECT_START(fota_area)
+STATS_SECT_ENTRY32(count)
+STATS_SECT_ENTRY32(errors)
+STATS_SECT_ENTRY32(bytes)
+STATS_SECT_END;
+
+STATS_NAME_START(fota_area)
+STATS_NAME(fota_area, count)
+STATS_NAME(fota_area, errors)
+STATS_NAME(fota_area, bytes)
+STATS_NAME_END(fota_area);
+
+static STATS_SECT_DECL(fota_op) op_stats[FOTA_STATS_OP_COUNT];
+static STATS_SECT_DECL(fota_area) area_stats[FOTA_STATS_AREA_COUNT];
+
+static const char *const op_names[FOTA_STATS_OP_COUNT] = {
+    [FOTA_STATS_READ] = "fota_read",
+    [FOTA_STATS_WRITE] = "fota_write",
+    [FOTA_STATS_ERASE] = "fota_erase",
+    [FOTA_STATS_HEADER_READ] = "fota_hdr_read",
+    [FOTA_STATS_HEADER_WRITE] = "fota_hdr_write",
+};
+
+static const char *const area_names[FOTA_STATS_AREA_COUNT] = {
+    [FOTA_STATS_BODY] = "fota_body",
+    [FOTA_STATS_HEADER_MIRROR] = "fota_hdr_mirror",
+    [FOTA_STATS_TRAILER_MIRROR] = "fota_trl_mirror",
+};
+
+void fota_stats_init(
+    void)
+{
+    static bool registered;
+    if (registered) {
+        return;
+    }
+    registered = true;
+    for (int i = 0; i < FOTA_STATS_OP_COUNT; i++) {
+        stats_init_and_reg(&op_stats[i].s_hdr,
+            STATS_SIZE_INIT_PARMS(op_stats[i], STATS_SIZE_32),
+            STATS_NAME_INIT_PARMS(fota_op),
+            op_names[i]);
+    }
+    for (int i = 0; i < FOTA_STATS_AREA_COUNT; i++) {
+        stats_init_and_reg(&area_stats[i].s_hdr,
+            STATS_SIZE_INIT_PARMS(area_stats[i], STATS_SIZE_32),
+            STATS_NAME_INIT_PARMS(fota_area),
+            area_names[i]);
+    }
+}
+
+uint32_t fota_stats_begin(
+    void)
+{
+    return k_cycle_get_32();
+}
+
+void fota_stats_end(
+    enum fota_stats_op op,
+    enum fota_stats_area area,
+    uint32_t begin,
+    uint32_t length,
+    int err)
+{
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - begin);
+    STATS_SECT_DECL(fota_op) *s = &op_stats[op];
+    STATS_SECT_DECL(fota_area) *a = &area_stats[area];
+
+    STATS_INC(*s, count);
+    STATS_INC(*a, count);
+    if (err != 0) {
+        STATS_INC(*s, errors);
+        STATS_INC(*a, errors);
+        return;
+    }
+    STATS_INCN(*s, bytes, length);
+    STATS_INCN(*a, bytes, length);
+    STATS_INCN(*s, total_us, us);
+    if (us > s->max_us) {
+        STATS_SET(*s, max_us, us);
+    }
+    if (us < 100) {
+        STATS_INC(*s, lt_100us);
+    } else if (us < 1000) {
+        STATS_INC(*s, lt_1ms);
+    } else if (us < 10000) {
+        STATS_INC(*s, lt_10ms);
+    } else if (us < 100000) {
+        STATS_INC(*s, lt_100ms);
+    } else {
+        STATS_INC(*s, ge_100ms);
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_STATS_H
+#define FOTA_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Flash operations of the FOTA driver, counted per operation and per
+ * area in Zephyr stats groups, which can be queried with
+ * "mcumgr stat <group>":
+ *
+ * - fota_read, fota_write, fota_erase, fota_hdr_read, fota_hdr_write:
+ *   calls, errors, bytes, total and longest time, and a latency histogram
+ * - fota_body, fota_hdr_mirror, fota_trl_mirror: calls, errors and bytes
+ *   of all operations on the SWAP or second slot data, the header backup
+ *   page and the trailer backup page
+ */
+enum fota_stats_op {
+    FOTA_STATS_READ,
+    FOTA_STATS_WRITE,
+    FOTA_STATS_ERASE,
+    FOTA_STATS_HEADER_READ,
+    FOTA_STATS_HEADER_WRITE,
+    FOTA_STATS_OP_COUNT
+};
+
+enum fota_stats_area {
+    FOTA_STATS_BODY,
+    FOTA_STATS_HEADER_MIRROR,
+    FOTA_STATS_TRAILER_MIRROR,
+    FOTA_STATS_AREA_COUNT
+};
+
+#if CONFIG_MIRA_FOTA_STATS
+/**
+ * Register the stats groups.
+ */
+void fota_stats_init(
+    void);
+
+/**
+ * Start timing a flash operation.
+ *
+ * @return Timestamp to pass to fota_stats_end.
+ */
+uint32_t fota_stats_begin(
+    void);
+
+/**
+ * Count a finished flash operation.
+ *
+ * Counters are updated without locking, an operation finishing at the
+ * same time in another thread may go uncounted.
+ */
+void fota_stats_end(
+    enum fota_stats_op op,
+    enum fota_stats_area area,
+    uint32_t begin,
+    uint32_t length,
+    int err);
+#else
+static inline void fota_stats_init(
+    void)
+{
+}
+
+static inline uint32_t fota_stats_begin(
+    void)
+{
+    return 0;
+}
+
+static inline void fota_stats_end(
+    enum fota_stats_op op,
+    enum fota_stats_area area,
+    uint32_t begin,
+    uint32_t length,
+    int err)
+{
+}
+#endif
+
+#endif /* FOTA_STATS_H */
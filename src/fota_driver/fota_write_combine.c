@@ -0,0 +1,182 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_write_combine.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+#if CONFIG_MIRA_FOTA_LOGGING
+LOG_MODULE_DECLARE(fota_driver, CONFIG_MIRA_FOTA_DRIVER_LOG_LEVEL);
+#else
+LOG_MODULE_DECLARE(fota_driver, 0);
+#endif
+
+#define FLASH_PAGE_SIZE 0x1000
+
+static K_MUTEX_DEFINE(combine_lock);
+
+static fota_write_combine_write_fn write_run;
+static struct fota_write_combine_stats stats;
+
+/* Buffered run [buf_address, buf_address + buf_length) in one page */
+static uint8_t page_buf[FLASH_PAGE_SIZE];
+static uint16_t buf_slot_id;
+static uint32_t buf_address;
+static uint32_t buf_length;
+
+static uint32_t page_end(
+    uint32_t address)
+{
+    return ROUND_DOWN(address, FLASH_PAGE_SIZE) + FLASH_PAGE_SIZE;
+}
+
+static int flush_locked(
+    void)
+{
+    if (buf_length == 0) {
+        return 0;
+    }
+
+    if (buf_address + buf_length == page_end(buf_address)
+        && buf_address % FLASH_PAGE_SIZE == 0) {
+        stats.page_flushes++;
+    } else {
+        stats.partial_flushes++;
+    }
+    LOG_DBG("Flushing combined write, offset: %d, length: %d",
+        buf_address,
+        buf_length);
+    uint32_t length = buf_length;
+    /* A failed run is not retried, the error fails the image instead */
+    buf_length = 0;
+    return write_run(buf_slot_id, page_buf, buf_address, length);
+}
+
+void fota_write_combine_init(
+    fota_write_combine_write_fn write_fn)
+{
+    write_run = write_fn;
+}
+
+int fota_write_combine_write(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length)
+{
+    const uint8_t *fragment = data;
+    int ret = 0;
+
+    k_mutex_lock(&combine_lock, K_FOREVER);
+    stats.fragments++;
+
+    while (ret == 0 && length > 0) {
+        if (buf_length != 0
+            && (slot_id != buf_slot_id || address != buf_address + buf_length)) {
+            /* Out of order, the buffered run can not be extended */
+            ret = flush_locked();
+            if (ret != 0) {
+                break;
+            }
+        }
+
+        if (buf_length == 0) {
+            if (address % FLASH_PAGE_SIZE == 0 && length >= FLASH_PAGE_SIZE) {
+                uint32_t run = ROUND_DOWN(length, FLASH_PAGE_SIZE);
+                stats.direct_writes++;
+                ret = write_run(slot_id, fragment, address, run);
+                fragment += run;
+                address += run;
+                length -= run;
+                continue;
+            }
+            buf_slot_id = slot_id;
+            buf_address = address;
+        }
+
+        uint32_t n = MIN(length, page_end(address) - address);
+        memcpy(&page_buf[buf_length], fragment, n);
+        buf_length += n;
+        fragment += n;
+        address += n;
+        length -= n;
+
+        if (buf_address + buf_length == page_end(buf_address)) {
+            ret = flush_locked();
+        }
+    }
+
+    k_mutex_unlock(&combine_lock);
+    return ret;
+}
+
+int fota_write_combine_flush_range(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length)
+{
+    int ret = 0;
+
+    k_mutex_lock(&combine_lock, K_FOREVER);
+    if (buf_length != 0
+        && slot_id == buf_slot_id
+        && address < buf_address + buf_length
+        && address + length > buf_address) {
+        ret = flush_locked();
+    }
+    k_mutex_unlock(&combine_lock);
+    return ret;
+}
+
+int fota_write_combine_flush(
+    void)
+{
+    k_mutex_lock(&combine_lock, K_FOREVER);
+    int ret = flush_locked();
+    k_mutex_unlock(&combine_lock);
+    return ret;
+}
+
+void fota_write_combine_discard(
+    uint16_t slot_id)
+{
+    k_mutex_lock(&combine_lock, K_FOREVER);
+    if (slot_id == buf_slot_id) {
+        buf_length = 0;
+    }
+    k_mutex_unlock(&combine_lock);
+}
+
+void fota_write_combine_get_stats(
+    struct fota_write_combine_stats *out)
+{
+    k_mutex_lock(&combine_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&combine_lock);
+}
@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_WRITE_COMBINE_H
+#define FOTA_WRITE_COMBINE_H
+
+#include <stdint.h>
+
+struct fota_write_combine_stats {
+    /* Fragments given to fota_write_combine_write */
+    uint32_t fragments;
+    /* Flushes of a completely filled page */
+    uint32_t page_flushes;
+    /* Flushes of a partially filled page */
+    uint32_t partial_flushes;
+    /* Page aligned runs written without buffering */
+    uint32_t direct_writes;
+};
+
+/**
+ * Function writing a combined run of fragments to flash.
+ *
+ * A run never crosses a flash page boundary unless it is a page aligned
+ * run of whole pages. Returns 0 or a flash error.
+ */
+typedef int (*fota_write_combine_write_fn)(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Set the function used to write combined runs to flash.
+ */
+void fota_write_combine_init(
+    fota_write_combine_write_fn write_fn);
+
+/**
+ * Add a fragment to the page buffer.
+ *
+ * The buffer is written when the page is complete, or before a fragment
+ * that does not continue where the previous one ended is buffered.
+ *
+ * @return 0 on success, or the error of a run written by this call. The
+ *         failed run may hold earlier fragments, so the image as a whole
+ *         is to be treated as broken.
+ */
+int fota_write_combine_write(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Write the buffered data if it overlaps the given range.
+ *
+ * @return 0 on success, or the error of the write.
+ */
+int fota_write_combine_flush_range(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Write any buffered data.
+ *
+ * @return 0 on success, or the error of the write.
+ */
+int fota_write_combine_flush(
+    void);
+
+/**
+ * Drop data buffered for a slot without writing it.
+ *
+ * @param slot_id Slot being erased.
+ */
+void fota_write_combine_discard(
+    uint16_t slot_id);
+
+void fota_write_combine_get_stats(
+    struct fota_write_combine_stats *stats);
+
+#endif /* FOTA_WRITE_COMBINE_H */
@@ -0,0 +1,331 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "fota_write_queue.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+#include <errno.h>
+#include <string.h>
+
+#if CONFIG_MIRA_FOTA_LOGGING
+LOG_MODULE_DECLARE(fota_driver, CONFIG_MIRA_FOTA_DRIVER_LOG_LEVEL);
+#else
+LOG_MODULE_DECLARE(fota_driver, 0);
+#endif
+
+struct fota_write_entry {
+    /* Reserved for the kernel's FIFO implementation */
+    void *fifo_reserved;
+    /* In pending_list until the fragment is in flash */
+    sys_snode_t node;
+    uint16_t slot_id;
+    uint32_t address;
+    uint32_t length;
+    void (*done_callback)(void *storage);
+    void *storage;
+    /* The copy below, or the caller's buffer for the held entry */
+    const uint8_t *data;
+};
+
+struct fota_write_copy {
+    struct fota_write_entry entry;
+    uint8_t data[CONFIG_MIRA_FOTA_WRITE_QUEUE_FRAGMENT_SIZE];
+};
+
+K_MEM_SLAB_DEFINE_STATIC(write_entry_slab,
+    sizeof(struct fota_write_copy),
+    CONFIG_MIRA_FOTA_WRITE_QUEUE_DEPTH,
+    4);
+static K_FIFO_DEFINE(write_fifo);
+
+/*
+ * A fragment that does not fit in a free copy is held by reference, and
+ * its done callback holds MiraMesh back until it is in flash.
+ */
+static struct fota_write_entry held_entry;
+static bool held;
+
+/* Submitted writes that are not yet in flash, in order */
+static K_MUTEX_DEFINE(pending_lock);
+static K_CONDVAR_DEFINE(pending_done);
+static sys_slist_t pending_list;
+static uint32_t pending;
+/* First failed write, see fota_write_queue_reset */
+static int write_error;
+static uint16_t write_error_slot_id;
+
+static fota_write_queue_write_fn write_fragment;
+static struct fota_write_queue_stats stats;
+
+extern const k_tid_t fota_write_worker_thread_id;
+
+static bool in_worker_context(
+    void)
+{
+    return k_current_get() == fota_write_worker_thread_id;
+}
+
+static void release_entry(
+    struct fota_write_entry *entry)
+{
+    if (entry == &held_entry) {
+        k_mutex_lock(&pending_lock, K_FOREVER);
+        held = false;
+        k_mutex_unlock(&pending_lock);
+    } else {
+        k_mem_slab_free(&write_entry_slab,
+            CONTAINER_OF(entry, struct fota_write_copy, entry));
+    }
+}
+
+static void process_entry(
+    struct fota_write_entry *entry)
+{
+    void (*done_callback)(void *storage) = entry->done_callback;
+    void *storage = entry->storage;
+    uint16_t slot_id = entry->slot_id;
+    uint32_t address = entry->address;
+
+    int ret = write_fragment(slot_id, entry->data, address, entry->length);
+
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    sys_slist_find_and_remove(&pending_list, &entry->node);
+    stats.completed++;
+    pending--;
+    if (ret != 0 && write_error == 0) {
+        write_error = ret;
+        write_error_slot_id = slot_id;
+    }
+    /* Readers wait for the fragments overlapping their range */
+    k_condvar_broadcast(&pending_done);
+    k_mutex_unlock(&pending_lock);
+
+    /*
+     * Release the entry before calling back, so MiraMesh can queue the
+     * next fragment from the done callback without waiting for itself.
+     */
+    release_entry(entry);
+
+    /* A failed fragment is not reported as written */
+    if (ret != 0) {
+        LOG_ERR("Queued write to slot %u at %u failed: %d", slot_id, address, ret);
+        return;
+    }
+    done_callback(storage);
+}
+
+/*
+ * Write everything still in the FIFO from the worker thread itself. Used
+ * when the worker's own done callback ends up back in the driver, where
+ * waiting for the worker would deadlock.
+ */
+static void drain_in_worker(
+    void)
+{
+    struct fota_write_entry *entry;
+
+    while ((entry = k_fifo_get(&write_fifo, K_NO_WAIT)) != NULL) {
+        process_entry(entry);
+    }
+}
+
+static void fota_write_worker(
+    void)
+{
+    while (1) {
+        struct fota_write_entry *entry = k_fifo_get(&write_fifo, K_FOREVER);
+        process_entry(entry);
+    }
+}
+
+K_THREAD_DEFINE(fota_write_worker_thread_id,
+    CONFIG_MIRA_FOTA_WRITE_WORKER_STACK_SIZE,
+    fota_write_worker,
+    NULL,
+    NULL,
+    NULL,
+    CONFIG_MIRA_FOTA_WRITE_WORKER_PRIORITY,
+    0,
+    0);
+
+/*
+ * Take a free copy for the fragment, or the held entry when the fragment
+ * is too large or the copies are all in use.
+ */
+static struct fota_write_entry *take_entry(
+    const void *data,
+    uint32_t length)
+{
+    struct fota_write_copy *copy;
+
+    if (length <= CONFIG_MIRA_FOTA_WRITE_QUEUE_FRAGMENT_SIZE
+        && k_mem_slab_alloc(&write_entry_slab, (void **) &copy, K_NO_WAIT) == 0) {
+        memcpy(copy->data, data, length);
+        copy->entry.data = copy->data;
+        return &copy->entry;
+    }
+
+    struct fota_write_entry *entry = NULL;
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    if (!held) {
+        held = true;
+        held_entry.data = data;
+        entry = &held_entry;
+        stats.held++;
+    }
+    k_mutex_unlock(&pending_lock);
+    return entry;
+}
+
+static bool overlaps_pending(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length)
+{
+    struct fota_write_entry *entry;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&pending_list, entry, node) {
+        if (entry->slot_id == slot_id
+            && address < entry->address + entry->length
+            && address + length > entry->address) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void fota_write_queue_init(
+    fota_write_queue_write_fn write_fn)
+{
+    write_fragment = write_fn;
+}
+
+int fota_write_queue_submit(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length,
+    void (*done_callback)(void *storage),
+    void *storage)
+{
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    int ret = write_error;
+    k_mutex_unlock(&pending_lock);
+    if (ret != 0) {
+        return ret;
+    }
+
+    struct fota_write_entry *entry = take_entry(data, length);
+    if (entry == NULL && in_worker_context()) {
+        /* From the worker's own done callback the queue can be emptied here */
+        drain_in_worker();
+        entry = take_entry(data, length);
+    }
+    if (entry == NULL) {
+        /*
+         * MiraMesh has more writes outstanding than the queue holds,
+         * without waiting for their done callbacks.
+         */
+        k_mutex_lock(&pending_lock, K_FOREVER);
+        stats.rejected++;
+        k_mutex_unlock(&pending_lock);
+        LOG_ERR("Write queue full, fragment at %u rejected", address);
+        return -ENOBUFS;
+    }
+
+    entry->slot_id = slot_id;
+    entry->address = address;
+    entry->length = length;
+    entry->done_callback = done_callback;
+    entry->storage = storage;
+
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    sys_slist_append(&pending_list, &entry->node);
+    pending++;
+    stats.submitted++;
+    stats.max_depth = MAX(stats.max_depth, pending);
+    k_mutex_unlock(&pending_lock);
+
+    k_fifo_put(&write_fifo, entry);
+    return 0;
+}
+
+int fota_write_queue_flush_range(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length)
+{
+    bool worker = in_worker_context();
+    if (worker) {
+        drain_in_worker();
+    }
+
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    while (!worker && overlaps_pending(slot_id, address, length)) {
+        k_condvar_wait(&pending_done, &pending_lock, K_FOREVER);
+    }
+    int ret = write_error;
+    k_mutex_unlock(&pending_lock);
+    return ret;
+}
+
+int fota_write_queue_flush(
+    void)
+{
+    bool worker = in_worker_context();
+    if (worker) {
+        drain_in_worker();
+    }
+
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    while (!worker && pending != 0) {
+        k_condvar_wait(&pending_done, &pending_lock, K_FOREVER);
+    }
+    int ret = write_error;
+    k_mutex_unlock(&pending_lock);
+    return ret;
+}
+
+void fota_write_queue_reset(
+    uint16_t slot_id)
+{
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    if (write_error != 0 && write_error_slot_id == slot_id) {
+        write_error = 0;
+    }
+    k_mutex_unlock(&pending_lock);
+}
+
+void fota_write_queue_get_stats(
+    struct fota_write_queue_stats *out)
+{
+    k_mutex_lock(&pending_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&pending_lock);
+}
@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FOTA_WRITE_QUEUE_H
+#define FOTA_WRITE_QUEUE_H
+
+#include <stdint.h>
+
+struct fota_write_queue_stats {
+    /* Writes accepted by fota_write_queue_submit */
+    uint32_t submitted;
+    /* Writes completed by the flash worker */
+    uint32_t completed;
+    /* Writes held by reference, too large for a copy or with no copy free */
+    uint32_t held;
+    /* Submits rejected because the held entry was in use too */
+    uint32_t rejected;
+    /* Highest number of queued writes seen */
+    uint32_t max_depth;
+};
+
+/**
+ * Function doing the actual flash writes for a queued fragment, returns
+ * 0 or a flash error.
+ */
+typedef int (*fota_write_queue_write_fn)(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Set the function used by the flash worker to write fragments.
+ *
+ * Must be called before the first fota_write_queue_submit.
+ */
+void fota_write_queue_init(
+    fota_write_queue_write_fn write_fn);
+
+/**
+ * Queue a fragment and return.
+ *
+ * The fragment is written by the flash worker thread, which calls
+ * done_callback once the data is in flash. The caller never waits for
+ * the flash. The fragment is copied into a free queue entry. If it is
+ * larger than an entry, or no entry is free, one fragment is held by
+ * reference instead, and the caller must keep data until done_callback.
+ * That is the contract of every driver call with a done callback, a
+ * read may also fill in its data up to the callback. As done_callback
+ * is only called once the fragment is in flash, it holds MiraMesh back
+ * until the worker has caught up.
+ *
+ * If the worker fails to write a fragment, its done_callback is not
+ * called and the error is kept until fota_write_queue_reset. Until then
+ * every submit and flush returns it.
+ *
+ * @retval 0 Fragment queued.
+ * @retval -ENOBUFS No entry free and a fragment already held, more
+ *                  fragments are outstanding than the queue holds.
+ * @retval <0 An earlier fragment could not be written.
+ */
+int fota_write_queue_submit(
+    uint16_t slot_id,
+    const void *data,
+    uint32_t address,
+    uint32_t length,
+    void (*done_callback)(void *storage),
+    void *storage);
+
+/**
+ * Wait until the queued fragments overlapping a range of a slot have
+ * been written to flash.
+ *
+ * @return 0 on success, or the error of the first failed write.
+ */
+int fota_write_queue_flush_range(
+    uint16_t slot_id,
+    uint32_t address,
+    uint32_t length);
+
+/**
+ * Wait until all queued fragments have been written to flash.
+ *
+ * @return 0 on success, or the error of the first failed write.
+ */
+int fota_write_queue_flush(
+    void);
+
+/**
+ * Forget a failed write to a slot, once the slot is erased.
+ */
+void fota_write_queue_reset(
+    uint16_t slot_id);
+
+void fota_write_queue_get_stats(
+    struct fota_write_queue_stats *stats);
+
+#endif /* FOTA_WRITE_QUEUE_H */
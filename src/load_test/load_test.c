@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "load_test.h"
+#include "source_stats.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <miramesh.h>
+
+#define LOAD_TEST_MAGIC 0x544c5a4d /* "MZLT" */
+
+#if CONFIG_LOAD_TEST
+static uint32_t sequence;
+static uint32_t sent;
+static uint32_t failed;
+/* Uptime the next packet and the current burst are due, ms */
+static int64_t next_send;
+static int64_t burst_start;
+static uint32_t burst_count;
+static int64_t last_report;
+static bool started;
+#endif
+
+static uint8_t pattern(
+    uint32_t sequence,
+    size_t index)
+{
+    return (sequence + index) & 0xff;
+}
+
+#if CONFIG_LOAD_TEST
+size_t load_test_fill(
+    uint8_t *buf,
+    size_t size)
+{
+    if (size < LOAD_TEST_HEADER_SIZE) {
+        return 0;
+    }
+    sys_put_le32(LOAD_TEST_MAGIC, &buf[0]);
+    sys_put_le32(sequence, &buf[4]);
+    sys_put_le32(k_uptime_get_32(), &buf[8]);
+    for (size_t i = LOAD_TEST_HEADER_SIZE; i < size; i++) {
+        buf[i] = pattern(sequence, i);
+    }
+    sequence++;
+    return size;
+}
+
+uint32_t load_test_sent(
+    bool success)
+{
+    int64_t now = k_uptime_get();
+
+    if (success) {
+        sent++;
+    } else {
+        failed++;
+    }
+    if (!started || now - last_report >= CONFIG_LOAD_TEST_REPORT_INTERVAL_MS) {
+        printf("Load test: %u packets sent, %u send failures\n", sent, failed);
+        last_report = now;
+    }
+
+    /*
+     * Packets are scheduled from when they were due rather than when
+     * they were sent, to keep the rate. After a pause, for example while
+     * the node was not joined, a new burst starts instead of catching up.
+     */
+    if (!started || now - next_send > CONFIG_LOAD_TEST_PACKET_INTERVAL_MS) {
+        next_send = now;
+        burst_start = now;
+        burst_count = 0;
+        started = true;
+    }
+    burst_count++;
+    if (CONFIG_LOAD_TEST_BURST_INTERVAL_MS > 0
+        && burst_count >= CONFIG_LOAD_TEST_BURST_LENGTH) {
+        burst_start += CONFIG_LOAD_TEST_BURST_INTERVAL_MS;
+        burst_count = 0;
+        next_send = MAX(burst_start, next_send + CONFIG_LOAD_TEST_PACKET_INTERVAL_MS);
+    } else {
+        next_send += CONFIG_LOAD_TEST_PACKET_INTERVAL_MS;
+    }
+    return next_send > now ? next_send - now : 0;
+}
+#endif /* CONFIG_LOAD_TEST */
+
+int load_test_parse(
+    const uint8_t *data,
+    size_t length,
+    uint32_t *sequence)
+{
+    if (length < LOAD_TEST_HEADER_SIZE || sys_get_le32(&data[0]) != LOAD_TEST_MAGIC) {
+        return -EBADMSG;
+    }
+    *sequence = sys_get_le32(&data[4]);
+    for (size_t i = LOAD_TEST_HEADER_SIZE; i < length; i++) {
+        if (data[i] != pattern(*sequence, i)) {
+            return -EBADMSG;
+        }
+    }
+    return 0;
+}
+
+static void report_entry(
+    const struct source_stats_entry *entry,
+    void *ctx)
+{
+    char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
+
+    if (!entry->sequence_valid) {
+        return;
+    }
+    uint32_t delivered = entry->packets - entry->duplicates;
+    uint32_t expected = delivered + entry->lost;
+    uint32_t pdr = expected > 0 ? (uint64_t) delivered * 1000 / expected : 0;
+    uint32_t duration = entry->last_seen - entry->first_seen;
+    uint32_t throughput = duration > 0 ? (uint64_t) entry->bytes * 1000 / duration : 0;
+
+    printf("[%s] %u received, %u lost, PDR %u.%u%%, %u B/s, "
+        "%u duplicate, %u reordered, %u restarts\n",
+        mira_net_toolkit_format_address(buffer, &entry->address),
+        delivered,
+        entry->lost,
+        pdr / 10,
+        pdr % 10,
+        throughput,
+        entry->duplicates,
+        entry->reordered,
+        entry->restarts);
+}
+
+void load_test_report(
+    void)
+{
+    source_stats_for_each(report_entry, NULL);
+}
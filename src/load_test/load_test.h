@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef LOAD_TEST_H
+#define LOAD_TEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Load test traffic. In load test mode a node sends packets with a
+ * sequence number and its send time to LOAD_TEST_UDP_PORT on the root,
+ * at the rate and burst pattern set in Kconfig. The root counts them
+ * per sender in the source statistics table, where gaps in the
+ * sequence are counted as lost packets.
+ *
+ * Payload, little endian:
+ *
+ * Offset | Size | Field
+ * -------|------|----------------------------------------------
+ * 0      | 4    | Magic, "MZLT"
+ * 4      | 4    | Sequence number, 0 for the first packet after boot
+ * 8      | 4    | Uptime of the sender when sent, ms
+ * 12     | -    | Pattern, byte i is (sequence + i) & 0xff
+ */
+
+#define LOAD_TEST_UDP_PORT 458
+
+#define LOAD_TEST_HEADER_SIZE 12
+
+/**
+ * Write the next packet of the sequence.
+ *
+ * @return Payload length, or 0 if size is smaller than the header.
+ */
+size_t load_test_fill(
+    uint8_t *buf,
+    size_t size);
+
+/**
+ * Record the result of sending the packet from load_test_fill, and
+ * print a report every CONFIG_LOAD_TEST_REPORT_INTERVAL_MS.
+ *
+ * @return Time until the next packet is due, ms.
+ */
+uint32_t load_test_sent(
+    bool success);
+
+/**
+ * Check a load test payload.
+ *
+ * @return 0 and the sequence number, or -EBADMSG if malformed.
+ */
+int load_test_parse(
+    const uint8_t *data,
+    size_t length,
+    uint32_t *sequence);
+
+/**
+ * Print the delivery ratio, loss and throughput of every sender in the
+ * source statistics table that has sent load test packets.
+ */
+void load_test_report(
+    void);
+
+#endif /* LOAD_TEST_H */
@@ -27,9 +27,9 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/console/console.h>
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/ring_buffer.h>
 #include <zephyr/device.h>
@@ -48,21 +48,43 @@
 #include "image_handling.h"
 #endif /* CONFIG_MIRA_FOTA_INIT */
 
-#define UDP_PORT 456
-#define CONFIG_LENGTH_TO_READ 2
-#define MIRA_MODE_LOCATION_CONFIG_AREA 0
+#include "boot_profile.h"
+#include "echo.h"
+#include "load_test.h"
+#include "node_config.h"
+#if CONFIG_RATE_CONTROL
+#include "rate_control.h"
+#endif
+#include "root_rx.h"
+#include "source_stats.h"
+#if CONFIG_UPLINK_BATCH
+#include "uplink.h"
+
+BUILD_ASSERT(CONFIG_UPLINK_BATCH_PAYLOAD_SIZE <= CONFIG_ROOT_RX_MAX_PAYLOAD_SIZE,
+    "The root drops uplink datagrams larger than its receive pool entries");
+#endif
 
-/* Values stored in config area for the different modes */
-#define NETWORK_MODE_ROOT 1
-#define NETWORK_MODE_ROOT_NO_RECONNECT 2
-#define NETWORK_MODE_LEAF 3
+/* Defaults of the fields in the node configuration */
+#define UDP_PORT 456
+#define SEND_INTERVAL_MS (60 * MSEC_PER_SEC)
+#define ROOT_ADDRESS_RETRY_INTERVAL K_SECONDS(1)
 
-#define CONFIG_AREA_DEVICE FIXED_PARTITION_DEVICE(CONFIG_AREA)
-#define CONFIG_AREA_OFFSET FIXED_PARTITION_OFFSET(CONFIG_AREA)
-#define CONFIG_AREA_SIZE FIXED_PARTITION_SIZE(CONFIG_ARE)
+/* Posted to net_events by network_state_callback */
+#define NET_EVENT_STATE_CHANGED BIT(0)
+/* Posted to init_events when the init work queue is done */
+#define INIT_EVENT_BLE_DONE BIT(0)
 
 #if CONFIG_MIRA_FOTA_INIT
 static mira_bool_t previous_fota_is_valid = false;
+#if CONFIG_MIRA_FOTA_COMPRESSED
+static mira_bool_t previous_second_slot_is_valid = false;
+#endif
+
+/* BLE and mcumgr are set up here, while the node joins the network */
+K_THREAD_STACK_DEFINE(init_queue_stack, CONFIG_MIRA_FOTA_INIT_QUEUE_STACK_SIZE);
+static struct k_work_q init_queue;
+static struct k_work ble_init_work;
+static K_EVENT_DEFINE(init_events);
 #endif /* CONFIG_MIRA_FOTA_INIT */
 
 static mira_net_config_t net_config = {
@@ -89,32 +111,87 @@ static mira_net_config_t net_config = {
     .prefix = NULL
 };
 
+static uint16_t udp_port = UDP_PORT;
+static uint32_t send_interval_ms = SEND_INTERVAL_MS;
+
 static volatile mira_net_state_t current_net_state = MIRA_NET_STATE_NOT_ASSOCIATED;
+/* Uptime when the node last joined, for the join to first send latency */
+static int64_t joined_time;
+static K_EVENT_DEFINE(net_events);
 
 static void network_state_callback(
     mira_net_state_t net_state)
 {
+    if (net_state == MIRA_NET_STATE_JOINED) {
+        joined_time = k_uptime_get();
+        boot_profile_end(BOOT_PHASE_JOIN);
+    }
     current_net_state = net_state;
+    k_event_post(&net_events, NET_EVENT_STATE_CHANGED);
+}
+
+static const char *net_state_str(
+    mira_net_state_t net_state)
+{
+    switch (net_state) {
+        case MIRA_NET_STATE_NOT_ASSOCIATED:
+            return "not associated";
+        case MIRA_NET_STATE_ASSOCIATED:
+            return "associated";
+        case MIRA_NET_STATE_JOINED:
+            return "joined";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+static void set_rate_from_config(
+    void)
+{
+    switch (node_config_get_u8(NODE_CONFIG_RATE, 0xff)) {
+        case NODE_CONFIG_RATE_FAST:
+            net_config.rate = MIRA_NET_RATE_FAST;
+            break;
+        case NODE_CONFIG_RATE_MID:
+            net_config.rate = MIRA_NET_RATE_MID;
+            break;
+        case NODE_CONFIG_RATE_SLOW:
+            net_config.rate = MIRA_NET_RATE_SLOW;
+            break;
+        default:
+            break;
+    }
 }
 
-static void set_network_mode_from_flash(
+static void set_network_config_from_flash(
     void)
 {
-    static char buf[CONFIG_LENGTH_TO_READ];
-    const struct device *config_area_flash_device = CONFIG_AREA_DEVICE;
-    flash_read(config_area_flash_device,
-        CONFIG_AREA_OFFSET,
-        buf,
-        CONFIG_LENGTH_TO_READ);
-
-    uint8_t val = atoi(&buf[MIRA_MODE_LOCATION_CONFIG_AREA]);
-    if (val == NETWORK_MODE_ROOT) {
+    int ret = node_config_init();
+    if (ret == -ENOENT) {
+        printf("No node config, using defaults\n");
+    } else if (ret != 0) {
+        printf("Invalid node config: %d, using defaults\n", ret);
+    }
+
+    uint8_t length;
+    const uint8_t *key = node_config_get(NODE_CONFIG_KEY, &length);
+    if (key != NULL && length == sizeof(net_config.key)) {
+        memcpy(net_config.key, key, sizeof(net_config.key));
+    }
+    net_config.pan_id = node_config_get_u32(NODE_CONFIG_PAN_ID, net_config.pan_id);
+    net_config.antenna = node_config_get_u8(NODE_CONFIG_ANTENNA, net_config.antenna);
+    set_rate_from_config();
+    udp_port = node_config_get_u16(NODE_CONFIG_UDP_PORT, udp_port);
+    send_interval_ms = node_config_get_u32(NODE_CONFIG_SEND_INTERVAL, send_interval_ms);
+
+    uint8_t val = node_config_get_u8(NODE_CONFIG_MODE, NODE_CONFIG_MODE_MESH);
+    if (val == NODE_CONFIG_MODE_ROOT) {
         printf("Starting as root\n");
         net_config.mode = MIRA_NET_MODE_ROOT;
-    } else if (val == NETWORK_MODE_ROOT_NO_RECONNECT) {
+    } else if (val == NODE_CONFIG_MODE_ROOT_NO_RECONNECT) {
         printf("Starting as root no reconnect\n");
         net_config.mode = MIRA_NET_MODE_ROOT_NO_RECONNECT;
-    } else if (val == NETWORK_MODE_LEAF) {
+    } else if (val == NODE_CONFIG_MODE_LEAF) {
         printf("Starting as leaf\n");
         net_config.mode = MIRA_NET_MODE_LEAF;
     } else {
@@ -123,6 +200,8 @@ static void set_network_mode_from_flash(
     }
 }
 
+#if !CONFIG_UPLINK_BATCH
+/* Batched uplink sends on its own connection, which has no callback */
 static void udp_listen_callback(
     mira_net_udp_connection_t *connection,
     const void *data,
@@ -141,11 +220,71 @@ static void udp_listen_callback(
     }
     printf("\n");
 }
+#endif /* !CONFIG_UPLINK_BATCH */
+
+/* Root packets, printed from the receive thread */
+static void print_packet(
+    const struct root_rx_packet *packet)
+{
+    char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
+
+    source_stats_update(&packet->source_address, packet->length, NULL);
+    boot_profile_end(BOOT_PHASE_FIRST_PACKET);
+    printf("Received message from [%s]:%u: %.*s\n",
+        mira_net_toolkit_format_address(buffer, &packet->source_address),
+        packet->source_port,
+        packet->length,
+        (const char *) packet->data);
+}
+
+#if CONFIG_UPLINK_BATCH
+static void print_uplink_record(
+    const uint8_t *data,
+    uint8_t length,
+    void *ctx)
+{
+    const char *source = ctx;
+    printf("Received record from [%s]: %.*s\n", source, length, (const char *) data);
+}
+
+static void print_uplink_packet(
+    const struct root_rx_packet *packet)
+{
+    char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
+
+    source_stats_update(&packet->source_address, packet->length, NULL);
+    boot_profile_end(BOOT_PHASE_FIRST_PACKET);
+    mira_net_toolkit_format_address(buffer, &packet->source_address);
+    if (uplink_parse(packet->data, packet->length, print_uplink_record,
+        buffer) != 0) {
+        printf("Malformed uplink datagram from [%s]\n", buffer);
+    }
+}
+#endif /* CONFIG_UPLINK_BATCH */
+
+/* Load test packets are only counted, load_test_report prints the totals */
+static void count_load_test_packet(
+    const struct root_rx_packet *packet)
+{
+    char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
+    uint32_t sequence;
+
+    if (load_test_parse(packet->data, packet->length, &sequence) != 0) {
+        printf("Malformed load test packet from [%s]\n",
+            mira_net_toolkit_format_address(buffer, &packet->source_address));
+        return;
+    }
+    source_stats_update(&packet->source_address, packet->length, &sequence);
+    boot_profile_end(BOOT_PHASE_FIRST_PACKET);
+}
 
 #if CONFIG_MIRA_FOTA_INIT
 static void check_fota_image_status(
     uint16_t slot_id)
 {
+    /* Images are handed to the DFU work queue, started by ble_init_handler */
+    k_event_wait(&init_events, INIT_EVENT_BLE_DONE, false, K_FOREVER);
+
     if (mira_fota_is_valid(FOTA_SLOT_ID)) {
         printf("FOTA image valid\n");
         if (!previous_fota_is_valid) {
@@ -156,6 +295,19 @@ static void check_fota_image_status(
         printf("FOTA image invalid!\n");
         previous_fota_is_valid = false;
     }
+#if CONFIG_MIRA_FOTA_COMPRESSED
+    /* Compressed images are installed from the second slot */
+    mira_bool_t second_slot_is_valid = mira_fota_is_valid(FOTA_SECOND_SLOT_ID);
+    printf("Compressed FOTA image %s\n", second_slot_is_valid ? "valid" : "invalid");
+    if (second_slot_is_valid && !previous_second_slot_is_valid) {
+        image_handling_install_compressed();
+    }
+    previous_second_slot_is_valid = second_slot_is_valid;
+#elif CONFIG_MIRA_FOTA_SECOND_SLOT
+    /* Only forwarded to other nodes, never installed here */
+    printf("FOTA image in second slot %s\n",
+        mira_fota_is_valid(FOTA_SECOND_SLOT_ID) ? "valid" : "invalid");
+#endif
 }
 #endif /* CONFIG_MIRA_FOTA_INIT */
 
@@ -171,15 +323,58 @@ static void poll_for_image(
 #endif /* CONFIG_MIRA_FOTA_INIT */
 }
 
+#if CONFIG_MIRA_FOTA_INIT
+static void ble_init_handler(
+    struct k_work *work)
+{
+    boot_profile_start(BOOT_PHASE_BLE_INIT);
+    dk_leds_init();
+    ble_init();
+    image_handling_init();
+    boot_profile_end(BOOT_PHASE_BLE_INIT);
+    k_event_post(&init_events, INIT_EVENT_BLE_DONE);
+}
+
+/*
+ * Nothing on the way to the first packet needs BLE or mcumgr, so they
+ * are set up on a work queue of their own instead of delaying the start
+ * of the network. The queue runs at a lower priority than main, and gets
+ * to run once main waits for the node to join.
+ */
+static void ble_init_start(
+    void)
+{
+    const struct k_work_queue_config init_queue_config = {
+        .name = "init"
+    };
+
+    k_work_queue_init(&init_queue);
+    k_work_queue_start(&init_queue,
+        init_queue_stack,
+        K_THREAD_STACK_SIZEOF(init_queue_stack),
+        CONFIG_MIRA_FOTA_INIT_QUEUE_PRIORITY,
+        &init_queue_config);
+    k_work_init(&ble_init_work, ble_init_handler);
+    k_work_submit_to_queue(&init_queue, &ble_init_work);
+}
+#endif /* CONFIG_MIRA_FOTA_INIT */
+
 void network_init(
     void)
 {
-    set_network_mode_from_flash();
+    boot_profile_start(BOOT_PHASE_CONFIG);
+    set_network_config_from_flash();
+    boot_profile_end(BOOT_PHASE_CONFIG);
     mira_net_register_net_state_cb(network_state_callback);
+    boot_profile_start(BOOT_PHASE_JOIN);
+    boot_profile_start(BOOT_PHASE_NET_INIT);
     mira_net_init(&net_config);
+    boot_profile_end(BOOT_PHASE_NET_INIT);
 #if CONFIG_MIRA_FOTA_INIT
+    boot_profile_start(BOOT_PHASE_FOTA_INIT);
     fota_driver_set_custom_driver();
     int ret = mira_fota_init();
+    boot_profile_end(BOOT_PHASE_FOTA_INIT);
     printf("mira_fota_init(): %d\n", ret);
 #endif /* CONFIG_MIRA_FOTA_INIT */
 }
@@ -187,54 +382,140 @@ void network_init(
 void send_hello_world(
     void)
 {
+#if !CONFIG_UPLINK_BATCH
     mira_net_udp_connection_t *conn;
-    mira_status_t res;
-    mira_net_address_t addr;
+#endif
+    mira_net_address_t root_address;
+    bool root_address_valid = false;
+    bool first_send_after_join = false;
     bool requested_fota_from_root = false;
+    k_timeout_t timeout = K_NO_WAIT;
+#if CONFIG_LOAD_TEST
+    uint8_t payload[CONFIG_LOAD_TEST_PAYLOAD_SIZE];
+    int64_t next_status_check = 0;
+#else
     char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
     char *message = "Hello world from Zephyr!";
+#endif
+#if CONFIG_ECHO_PROBE
+    echo_probe_init();
+#endif
+#if CONFIG_RATE_CONTROL
+    rate_control_init(net_config.rate);
+#endif
+#if CONFIG_UPLINK_BATCH
+    uplink_init();
+#else
     conn = mira_net_udp_connect(NULL, 0, udp_listen_callback, NULL);
+#endif
 
     while (1) {
-        if (current_net_state != MIRA_NET_STATE_JOINED) {
-            printf("Waiting for network (state is %s)\n",
-                current_net_state == MIRA_NET_STATE_NOT_ASSOCIATED ? "not associated"
-                : current_net_state == MIRA_NET_STATE_ASSOCIATED ? "associated"
-                : current_net_state == MIRA_NET_STATE_JOINED ? "joined"
-                : "UNKNOWN");
-            k_sleep(K_SECONDS(1));
-        } else {
-            res = mira_net_get_root_address(&addr);
-            if (res != MIRA_SUCCESS) {
+        /*
+         * Sleep until the next send is due, or until the network state
+         * changes, whichever comes first.
+         */
+        uint32_t events = k_event_wait(&net_events, NET_EVENT_STATE_CHANGED,
+            false, timeout);
+        if (events != 0) {
+            k_event_clear(&net_events, events);
+        }
+        mira_net_state_t net_state = current_net_state;
+
+        if (events & NET_EVENT_STATE_CHANGED) {
+            printf("Network state is %s\n", net_state_str(net_state));
+            /* The root may have changed, look it up again */
+            root_address_valid = false;
+            first_send_after_join = net_state == MIRA_NET_STATE_JOINED;
+        }
+        if (net_state != MIRA_NET_STATE_JOINED) {
+            timeout = K_FOREVER;
+            continue;
+        }
+        if (!root_address_valid) {
+            if (mira_net_get_root_address(&root_address) != MIRA_SUCCESS) {
                 printf("Waiting for root address\n");
-                k_sleep(K_SECONDS(1));
-            } else {
-                // Force a early fota request as soon as joined, useful for testing
-                if (!requested_fota_from_root) {
-                    poll_for_image();
-                    requested_fota_from_root = true;
-                }
-                printf("Sending to address: %s\n",
-                    mira_net_toolkit_format_address(buffer, &addr));
-                mira_net_udp_send_to(conn, &addr, UDP_PORT, message,
-                    strlen(message));
-#if CONFIG_MIRA_FOTA_INIT
-                check_fota_image_status(FOTA_SLOT_ID);
-#endif /* CONFIG_MIRA_FOTA_INIT */
-                k_sleep(K_SECONDS(60));
+                timeout = ROOT_ADDRESS_RETRY_INTERVAL;
+                continue;
             }
+            root_address_valid = true;
+        }
+
+        // Force a early fota request as soon as joined, useful for testing
+        if (!requested_fota_from_root) {
+            poll_for_image();
+            requested_fota_from_root = true;
+        }
+#if CONFIG_LOAD_TEST
+        size_t length = load_test_fill(payload, sizeof(payload));
+        mira_status_t status = mira_net_udp_send_to(conn, &root_address,
+            LOAD_TEST_UDP_PORT, payload, length);
+#if CONFIG_RATE_CONTROL
+        rate_control_report_send(status == MIRA_SUCCESS);
+#endif
+#elif CONFIG_UPLINK_BATCH
+        /* Goes out with other records, within the uplink latency */
+        printf("Queueing for address: %s\n",
+            mira_net_toolkit_format_address(buffer, &root_address));
+        uplink_send(message, strlen(message));
+#else
+        printf("Sending to address: %s\n",
+            mira_net_toolkit_format_address(buffer, &root_address));
+        mira_status_t status = mira_net_udp_send_to(conn, &root_address,
+            udp_port, message, strlen(message));
+        if (status != MIRA_SUCCESS) {
+            printf("Send failed: %d\n", status);
+        }
+#if CONFIG_RATE_CONTROL
+        rate_control_report_send(status == MIRA_SUCCESS);
+#endif
+#endif
+        if (first_send_after_join) {
+            printf("First send %u ms after joining\n",
+                (uint32_t) (k_uptime_get() - joined_time));
+            first_send_after_join = false;
+            boot_profile_end(BOOT_PHASE_FIRST_PACKET);
         }
+#if CONFIG_LOAD_TEST
+        timeout = K_MSEC(load_test_sent(status == MIRA_SUCCESS));
+        /* Checked at the usual interval, not for every packet */
+        if (k_uptime_get() < next_status_check) {
+            continue;
+        }
+        next_status_check = k_uptime_get() + send_interval_ms;
+#else
+        timeout = K_MSEC(send_interval_ms);
+#endif
+#if CONFIG_MIRA_FOTA_INIT
+        check_fota_image_status(FOTA_SLOT_ID);
+#endif /* CONFIG_MIRA_FOTA_INIT */
     }
 }
 
 void receieve_hello_world(
     void)
 {
-    mira_net_udp_listen(UDP_PORT, udp_listen_callback, NULL);
+    root_rx_listen(udp_port, print_packet);
+    root_rx_listen(LOAD_TEST_UDP_PORT, count_load_test_packet);
+#if CONFIG_ECHO_SERVICE
+    echo_service_init();
+#endif
+#if CONFIG_UPLINK_BATCH
+    root_rx_listen(UPLINK_UDP_PORT, print_uplink_packet);
+#endif
+#if CONFIG_SOURCE_STATS_REPORT_INTERVAL_S > 0
+    int64_t next_sources_report = CONFIG_SOURCE_STATS_REPORT_INTERVAL_S * 1000LL;
+#endif
     while (1) {
 #if CONFIG_MIRA_FOTA_INIT
         check_fota_image_status(FOTA_SLOT_ID);
 #endif /* CONFIG_MIRA_FOTA_INIT */
+        load_test_report();
+#if CONFIG_SOURCE_STATS_REPORT_INTERVAL_S > 0
+        if (k_uptime_get() >= next_sources_report) {
+            source_stats_print();
+            next_sources_report += CONFIG_SOURCE_STATS_REPORT_INTERVAL_S * 1000LL;
+        }
+#endif
         k_sleep(K_SECONDS(60));
     }
 }
@@ -242,6 +523,7 @@ void receieve_hello_world(
 int main(
     void)
 {
+    boot_profile_start(BOOT_PHASE_FIRST_PACKET);
     printf("-------------MiraMesh network example-------------\n");
 
     mira_sys_device_id_t devid;
@@ -257,13 +539,10 @@ int main(
         devid.u8[6],
         devid.u8[7]);
 
-    network_init();
-
 #if CONFIG_MIRA_FOTA_INIT
-    dk_leds_init();
-    ble_init();
-    image_handling_init();
+    ble_init_start();
 #endif /* CONFIG_MIRA_FOTA_INIT */
+    network_init();
 
     if (net_config.mode == MIRA_NET_MODE_ROOT
         || net_config.mode == MIRA_NET_MODE_ROOT_NO_RECONNECT) {
@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "node_config.h"
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+
+#define CONFIG_AREA_DEVICE FIXED_PARTITION_DEVICE(CONFIG_AREA)
+#define CONFIG_AREA_OFFSET FIXED_PARTITION_OFFSET(CONFIG_AREA)
+#define CONFIG_AREA_SIZE FIXED_PARTITION_SIZE(CONFIG_AREA)
+
+/* Fields of the checked configuration, none until node_config_init */
+static const uint8_t *fields;
+static uint16_t fields_length;
+
+/* The network mode of a configuration in the older text format */
+static uint8_t legacy_fields[3] = { NODE_CONFIG_MODE, 1, 0 };
+
+#if !CONFIG_NODE_CONFIG_MMAP
+static uint8_t buffer[CONFIG_NODE_CONFIG_BUFFER_SIZE];
+#endif
+
+/* Read the partition, in place when memory-mapped */
+static int map_area(
+    const uint8_t **area,
+    size_t length)
+{
+#if CONFIG_NODE_CONFIG_MMAP
+    ARG_UNUSED(length);
+    *area = (const uint8_t *) DT_REG_ADDR(DT_CHOSEN(zephyr_flash)) + CONFIG_AREA_OFFSET;
+    return 0;
+#else
+    *area = buffer;
+    return flash_read(CONFIG_AREA_DEVICE, CONFIG_AREA_OFFSET, buffer,
+        MIN(length, sizeof(buffer)));
+#endif
+}
+
+static size_t area_limit(
+    void)
+{
+#if CONFIG_NODE_CONFIG_MMAP
+    return CONFIG_AREA_SIZE;
+#else
+    return MIN(CONFIG_AREA_SIZE, sizeof(buffer));
+#endif
+}
+
+/* Every field has to fit, or the length is wrong */
+static bool fields_valid(
+    const uint8_t *data,
+    uint16_t length)
+{
+    uint16_t pos = 0;
+    while (pos < length) {
+        if (length - pos < 2 || length - pos - 2 < data[pos + 1]) {
+            return false;
+        }
+        pos += 2 + data[pos + 1];
+    }
+    return true;
+}
+
+int node_config_init(
+    void)
+{
+    const uint8_t *area;
+
+    fields = NULL;
+    fields_length = 0;
+    int ret = map_area(&area, area_limit());
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (sys_get_le32(&area[0]) != NODE_CONFIG_MAGIC) {
+        if (area[0] >= '1' && area[0] <= '9') {
+            legacy_fields[2] = area[0] - '0';
+            fields = legacy_fields;
+            fields_length = sizeof(legacy_fields);
+            return 0;
+        }
+        return -ENOENT;
+    }
+    if (area[4] != NODE_CONFIG_VERSION) {
+        return -ENOTSUP;
+    }
+    uint16_t length = sys_get_le16(&area[6]);
+    if (length > area_limit() - NODE_CONFIG_HEADER_SIZE) {
+        return -EBADMSG;
+    }
+    const uint8_t *data = &area[NODE_CONFIG_HEADER_SIZE];
+    if (crc32_ieee(data, length) != sys_get_le32(&area[8])
+        || !fields_valid(data, length)) {
+        return -EBADMSG;
+    }
+    fields = data;
+    fields_length = length;
+    return 0;
+}
+
+const uint8_t *node_config_get(
+    enum node_config_type type,
+    uint8_t *length)
+{
+    uint16_t pos = 0;
+    while (pos < fields_length) {
+        if (fields[pos] == type) {
+            *length = fields[pos + 1];
+            return &fields[pos + 2];
+        }
+        pos += 2 + fields[pos + 1];
+    }
+    return NULL;
+}
+
+uint8_t node_config_get_u8(
+    enum node_config_type type,
+    uint8_t default_value)
+{
+    uint8_t length;
+    const uint8_t *value = node_config_get(type, &length);
+    return value != NULL && length == 1 ? value[0] : default_value;
+}
+
+uint16_t node_config_get_u16(
+    enum node_config_type type,
+    uint16_t default_value)
+{
+    uint8_t length;
+    const uint8_t *value = node_config_get(type, &length);
+    return value != NULL && length == 2 ? sys_get_le16(value) : default_value;
+}
+
+uint32_t node_config_get_u32(
+    enum node_config_type type,
+    uint32_t default_value)
+{
+    uint8_t length;
+    const uint8_t *value = node_config_get(type, &length);
+    return value != NULL && length == 4 ? sys_get_le32(value) : default_value;
+}
@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef NODE_CONFIG_H
+#define NODE_CONFIG_H
+
+#include <stdint.h>
+
+/*
+ * Node configuration in the config_area partition, written by
+ * config2hex.py. The partition starts with a header, little endian:
+ *
+ * Offset | Size | Field
+ * -------|------|----------------------------------------------
+ * 0      | 4    | Magic, "MZCF"
+ * 4      | 1    | Layout version, NODE_CONFIG_VERSION
+ * 5      | 1    | Reserved, 0
+ * 6      | 2    | Length of the fields following the header
+ * 8      | 4    | CRC32 (IEEE) of the fields
+ *
+ * followed by the fields, each a type byte, a length byte and the value.
+ * Fields of unknown types are skipped, so a newer configuration can be
+ * read by older firmware as long as the version is unchanged. Fields
+ * that are missing, or have an unexpected length, take their default.
+ *
+ * A configuration in the older text format, a single digit with the
+ * network mode, is still accepted.
+ */
+
+#define NODE_CONFIG_MAGIC 0x46435a4d /* "MZCF" */
+#define NODE_CONFIG_VERSION 1
+#define NODE_CONFIG_HEADER_SIZE 12
+
+enum node_config_type {
+    /* uint8_t, NODE_CONFIG_MODE_* */
+    NODE_CONFIG_MODE = 1,
+    /* uint32_t */
+    NODE_CONFIG_PAN_ID = 2,
+    /* 16 bytes */
+    NODE_CONFIG_KEY = 3,
+    /* uint8_t, NODE_CONFIG_RATE_* */
+    NODE_CONFIG_RATE = 4,
+    /* uint8_t */
+    NODE_CONFIG_ANTENNA = 5,
+    /* uint16_t, port of the hello message */
+    NODE_CONFIG_UDP_PORT = 6,
+    /* uint32_t, time between hello messages, ms */
+    NODE_CONFIG_SEND_INTERVAL = 7,
+};
+
+/* Values of NODE_CONFIG_MODE, anything else starts a mesh node */
+#define NODE_CONFIG_MODE_ROOT 1
+#define NODE_CONFIG_MODE_ROOT_NO_RECONNECT 2
+#define NODE_CONFIG_MODE_LEAF 3
+#define NODE_CONFIG_MODE_MESH 4
+
+/* Values of NODE_CONFIG_RATE */
+#define NODE_CONFIG_RATE_FAST 0
+#define NODE_CONFIG_RATE_MID 1
+#define NODE_CONFIG_RATE_SLOW 2
+
+/**
+ * Check the configuration in config_area. Until this is called, or if
+ * it fails, every field takes its default.
+ *
+ * @return 0 on success, -ENOENT if the partition holds no configuration,
+ *         -ENOTSUP for an unknown layout version, -EBADMSG if the
+ *         configuration is corrupt, or a flash_read error.
+ */
+int node_config_init(
+    void);
+
+/**
+ * Find a field.
+ *
+ * @param length Set to the length of the value.
+ * @return The value, in place in flash if memory-mapped, or NULL if the
+ *         field is missing.
+ */
+const uint8_t *node_config_get(
+    enum node_config_type type,
+    uint8_t *length);
+
+uint8_t node_config_get_u8(
+    enum node_config_type type,
+    uint8_t default_value);
+
+uint16_t node_config_get_u16(
+    enum node_config_type type,
+    uint16_t default_value);
+
+uint32_t node_config_get_u32(
+    enum node_config_type type,
+    uint32_t default_value);
+
+#endif /* NODE_CONFIG_H */
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "rate_control.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+
+#if CONFIG_UPLINK_BATCH
+#include "uplink.h"
+#endif
+#if CONFIG_MIRA_FOTA_INIT
+#include "fota_driver.h"
+#endif
+
+/* Slowest first, the controller steps through them in order */
+static const mira_net_rate_t rates[] = {
+    MIRA_NET_RATE_SLOW,
+    MIRA_NET_RATE_MID,
+    MIRA_NET_RATE_FAST
+};
+
+#define FASTEST (ARRAY_SIZE(rates) - 1)
+
+/* Recommended rate */
+static int level;
+static int idle_periods;
+static int64_t last_change;
+
+static atomic_t send_failures;
+#if CONFIG_UPLINK_BATCH
+static uint32_t last_uplink_errors;
+#endif
+#if CONFIG_MIRA_FOTA_INIT
+static uint32_t last_fota_activity;
+/* Periods without image writes, up to CONFIG_RATE_CONTROL_FOTA_IDLE_PERIODS */
+static int fota_quiet_periods = CONFIG_RATE_CONTROL_FOTA_IDLE_PERIODS;
+#endif
+
+static void evaluate(
+    struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(rate_work, evaluate);
+
+const char *rate_control_rate_str(
+    mira_net_rate_t rate)
+{
+    switch (rate) {
+        case MIRA_NET_RATE_FAST:
+            return "fast";
+        case MIRA_NET_RATE_MID:
+            return "mid";
+        case MIRA_NET_RATE_SLOW:
+            return "slow";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+void rate_control_report_send(
+    bool success)
+{
+    if (!success) {
+        atomic_inc(&send_failures);
+    }
+}
+
+struct load {
+    uint32_t failures;
+    uint32_t queue_percent;
+    /* Receiving a FOTA image */
+    bool fota;
+};
+
+/* Load since the previous call */
+static void sample_load(
+    struct load *load)
+{
+    load->failures = atomic_set(&send_failures, 0);
+    load->queue_percent = 0;
+    load->fota = false;
+#if CONFIG_UPLINK_BATCH
+    struct uplink_stats stats;
+    uplink_get_stats(&stats);
+    load->queue_percent = stats.buffered * 100 / CONFIG_UPLINK_BATCH_BUFFER_SIZE;
+    load->failures += stats.send_errors - last_uplink_errors;
+    last_uplink_errors = stats.send_errors;
+#endif
+#if CONFIG_MIRA_FOTA_INIT
+    uint32_t activity = fota_driver_transfer_activity();
+    if (activity != last_fota_activity) {
+        fota_quiet_periods = 0;
+    } else if (fota_quiet_periods < CONFIG_RATE_CONTROL_FOTA_IDLE_PERIODS) {
+        fota_quiet_periods++;
+    }
+    last_fota_activity = activity;
+    /* MiraMesh may pause between parts of an image */
+    load->fota = fota_quiet_periods < CONFIG_RATE_CONTROL_FOTA_IDLE_PERIODS;
+#endif
+}
+
+static bool is_busy(
+    const struct load *load)
+{
+#if CONFIG_UPLINK_BATCH
+    if (load->queue_percent >= CONFIG_RATE_CONTROL_QUEUE_HIGH_PERCENT) {
+        return true;
+    }
+#endif
+    return load->failures >= CONFIG_RATE_CONTROL_FAILURE_THRESHOLD;
+}
+
+static bool is_idle(
+    const struct load *load)
+{
+#if CONFIG_UPLINK_BATCH
+    if (load->queue_percent > CONFIG_RATE_CONTROL_QUEUE_LOW_PERCENT) {
+        return false;
+    }
+#endif
+    return load->failures == 0;
+}
+
+static void change_rate(
+    int target,
+    const struct load *load)
+{
+    printf("Network rate %s -> %s recommended: %s, queue %u%%, %u failed sends\n",
+        rate_control_rate_str(rates[level]),
+        rate_control_rate_str(rates[target]),
+        load->fota ? "fota" : target > level ? "busy" : "idle",
+        load->queue_percent,
+        load->failures);
+    last_change = k_uptime_get();
+    idle_periods = 0;
+    level = target;
+}
+
+static void evaluate(
+    struct k_work *work)
+{
+    struct load load;
+
+    sample_load(&load);
+    /*
+     * Sends fail while the node is not joined, for example while it
+     * joins again after losing its parent, that is not a sign of load.
+     */
+    if (mira_net_get_state() != MIRA_NET_STATE_JOINED) {
+        idle_periods = 0;
+    } else if (load.fota) {
+        /* Not stepped down until the transfer is over */
+        idle_periods = 0;
+        if (level != FASTEST) {
+            change_rate(FASTEST, &load);
+        }
+    } else if (is_busy(&load) && level != FASTEST) {
+        change_rate(level + 1, &load);
+    } else if (is_idle(&load)) {
+        idle_periods++;
+        if (level > 0 && idle_periods >= CONFIG_RATE_CONTROL_IDLE_PERIODS
+            && k_uptime_get() - last_change >= CONFIG_RATE_CONTROL_HOLD_MS) {
+            change_rate(level - 1, &load);
+        }
+    } else {
+        idle_periods = 0;
+    }
+    k_work_schedule(&rate_work, K_MSEC(CONFIG_RATE_CONTROL_PERIOD_MS));
+}
+
+void rate_control_init(
+    mira_net_rate_t rate)
+{
+    level = FASTEST;
+    for (int i = 0; i < ARRAY_SIZE(rates); i++) {
+        if (rates[i] == rate) {
+            level = i;
+        }
+    }
+    last_change = k_uptime_get();
+    k_work_schedule(&rate_work, K_MSEC(CONFIG_RATE_CONTROL_PERIOD_MS));
+}
@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+#include <stdbool.h>
+#include <miramesh.h>
+
+/*
+ * Network rate controller. Every CONFIG_RATE_CONTROL_PERIOD_MS, while
+ * joined, the load of the last period is evaluated:
+ *
+ * - While the node receives a FOTA image, and until
+ *   CONFIG_RATE_CONTROL_FOTA_IDLE_PERIODS periods after its last image
+ *   write, the fastest rate is recommended.
+ * - An uplink buffer fill of CONFIG_RATE_CONTROL_QUEUE_HIGH_PERCENT, or
+ *   CONFIG_RATE_CONTROL_FAILURE_THRESHOLD failed sends, step up a rate.
+ * - CONFIG_RATE_CONTROL_IDLE_PERIODS periods in a row below
+ *   CONFIG_RATE_CONTROL_QUEUE_LOW_PERCENT and without failed sends step
+ *   down a rate, at most once per CONFIG_RATE_CONTROL_HOLD_MS.
+ *
+ * Every change is printed with the load that caused it. The network
+ * keeps the rate it was started with: libmira has no call to change the
+ * rate of a running network, and starting it again with mira_net_init
+ * would make the node leave and join the network.
+ */
+
+/**
+ * Start the controller.
+ *
+ * @param rate The rate the network was started with.
+ */
+void rate_control_init(
+    mira_net_rate_t rate);
+
+/**
+ * Count the result of a send to the root.
+ */
+void rate_control_report_send(
+    bool success);
+
+const char *rate_control_rate_str(
+    mira_net_rate_t rate);
+
+#endif /* RATE_CONTROL_H */
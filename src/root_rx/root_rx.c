@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "root_rx.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+#include <string.h>
+
+struct root_rx_entry {
+    /* Reserved for the kernel's FIFO implementation */
+    void *fifo_reserved;
+    root_rx_handler_fn handler;
+    struct root_rx_packet packet;
+};
+
+K_MEM_SLAB_DEFINE_STATIC(rx_entry_slab,
+    sizeof(struct root_rx_entry),
+    CONFIG_ROOT_RX_POOL_SIZE,
+    4);
+static K_FIFO_DEFINE(rx_fifo);
+
+/* Updated from the MiraMesh callback and the consumer thread */
+static atomic_t received;
+static atomic_t dropped;
+static atomic_t oversized;
+static atomic_t depth;
+static atomic_t max_depth;
+
+static void rx_callback(
+    mira_net_udp_connection_t *connection,
+    const void *data,
+    uint16_t data_len,
+    const mira_net_udp_callback_metadata_t *metadata,
+    void *storage)
+{
+    struct root_rx_entry *entry;
+
+    if (data_len > CONFIG_ROOT_RX_MAX_PAYLOAD_SIZE) {
+        atomic_inc(&oversized);
+        return;
+    }
+    if (k_mem_slab_alloc(&rx_entry_slab, (void **) &entry, K_NO_WAIT) != 0) {
+        atomic_inc(&dropped);
+        return;
+    }
+    entry->handler = storage;
+    entry->packet.source_address = *metadata->source_address;
+    entry->packet.source_port = metadata->source_port;
+    entry->packet.destination_port = metadata->destination_port;
+    entry->packet.length = data_len;
+    memcpy(entry->packet.data, data, data_len);
+
+    atomic_val_t new_depth = atomic_inc(&depth) + 1;
+    atomic_val_t old_max = atomic_get(&max_depth);
+    while (new_depth > old_max && !atomic_cas(&max_depth, old_max, new_depth)) {
+        old_max = atomic_get(&max_depth);
+    }
+    k_fifo_put(&rx_fifo, entry);
+}
+
+static void root_rx_consumer(
+    void)
+{
+    atomic_val_t reported_drops = 0;
+
+    while (1) {
+        struct root_rx_entry *entry = k_fifo_get(&rx_fifo, K_FOREVER);
+        atomic_dec(&depth);
+        entry->handler(&entry->packet);
+        k_mem_slab_free(&rx_entry_slab, entry);
+        atomic_inc(&received);
+
+        atomic_val_t drops = atomic_get(&dropped) + atomic_get(&oversized);
+        if (drops != reported_drops) {
+            printf("Receive pool: %u packets dropped\n", (uint32_t) drops);
+            reported_drops = drops;
+        }
+    }
+}
+
+K_THREAD_DEFINE(root_rx_consumer_thread_id,
+    CONFIG_ROOT_RX_STACK_SIZE,
+    root_rx_consumer,
+    NULL,
+    NULL,
+    NULL,
+    CONFIG_ROOT_RX_PRIORITY,
+    0,
+    0);
+
+mira_status_t root_rx_listen(
+    uint16_t port,
+    root_rx_handler_fn handler)
+{
+    return mira_net_udp_listen(port, rx_callback, handler);
+}
+
+void root_rx_get_stats(
+    struct root_rx_stats *stats)
+{
+    stats->received = atomic_get(&received);
+    stats->dropped = atomic_get(&dropped);
+    stats->oversized = atomic_get(&oversized);
+    stats->max_depth = atomic_get(&max_depth);
+}
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ROOT_RX_H
+#define ROOT_RX_H
+
+#include <stdint.h>
+#include <miramesh.h>
+
+/*
+ * Receive path of the root. The MiraMesh UDP callback only copies the
+ * packet into a preallocated pool and returns, a consumer thread passes
+ * the packets on to the handlers in the order they arrived. Packets
+ * arriving while the pool is exhausted are dropped and counted.
+ */
+struct root_rx_packet {
+    mira_net_address_t source_address;
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint16_t length;
+    uint8_t data[CONFIG_ROOT_RX_MAX_PAYLOAD_SIZE];
+};
+
+struct root_rx_stats {
+    /* Packets passed on to a handler */
+    uint32_t received;
+    /* Packets dropped because the pool was exhausted */
+    uint32_t dropped;
+    /* Packets dropped because they were larger than the pool entries */
+    uint32_t oversized;
+    /* Most packets waiting for the consumer at once */
+    uint32_t max_depth;
+};
+
+/**
+ * Function handling a received packet, called from the consumer thread.
+ */
+typedef void (*root_rx_handler_fn)(
+    const struct root_rx_packet *packet);
+
+/**
+ * Listen on a UDP port and pass the packets received on it to a handler.
+ *
+ * @return mira_net_udp_listen status.
+ */
+mira_status_t root_rx_listen(
+    uint16_t port,
+    root_rx_handler_fn handler);
+
+void root_rx_get_stats(
+    struct root_rx_stats *stats);
+
+#endif /* ROOT_RX_H */
@@ -0,0 +1,256 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "source_stats.h"
+
+#include <zephyr/kernel.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#else
+struct shell;
+#endif
+
+#define TABLE_SIZE CONFIG_SOURCE_STATS_TABLE_SIZE
+BUILD_ASSERT((TABLE_SIZE & (TABLE_SIZE - 1)) == 0,
+    "The source table size must be a power of two");
+
+/* Weight of a new interval in the smoothed inter-arrival time, 1/8 */
+#define INTERARRIVAL_SHIFT 3
+
+static K_MUTEX_DEFINE(table_lock);
+static struct source_stats_entry table[TABLE_SIZE];
+static uint32_t untracked;
+
+static uint32_t address_hash(
+    const mira_net_address_t *address)
+{
+    /* FNV-1a */
+    const uint8_t *bytes = (const uint8_t *) address;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(*address); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Entry of an address, claiming a free one for a new address */
+static struct source_stats_entry *lookup(
+    const mira_net_address_t *address)
+{
+    uint32_t index = address_hash(address);
+    for (uint32_t probe = 0; probe < TABLE_SIZE; probe++) {
+        struct source_stats_entry *entry = &table[(index + probe) & (TABLE_SIZE - 1)];
+        if (!entry->used) {
+            memset(entry, 0, sizeof(*entry));
+            entry->used = true;
+            entry->address = *address;
+            return entry;
+        }
+        if (memcmp(&entry->address, address, sizeof(*address)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void update_sequence(
+    struct source_stats_entry *entry,
+    uint32_t sequence)
+{
+    uint32_t diff = sequence - entry->last_sequence;
+
+    if (!entry->sequence_valid || sequence == 0) {
+        if (entry->sequence_valid) {
+            entry->restarts++;
+        }
+        entry->sequence_valid = true;
+    } else if (diff == 0) {
+        entry->duplicates++;
+        return;
+    } else if (diff < BIT(31)) {
+        entry->lost += diff - 1;
+    } else {
+        /* Counted as lost when the packet after it arrived */
+        entry->reordered++;
+        if (entry->lost > 0) {
+            entry->lost--;
+        }
+        return;
+    }
+    entry->last_sequence = sequence;
+}
+
+void source_stats_update(
+    const mira_net_address_t *address,
+    uint16_t length,
+    const uint32_t *sequence)
+{
+    uint32_t now = k_uptime_get_32();
+
+    k_mutex_lock(&table_lock, K_FOREVER);
+    struct source_stats_entry *entry = lookup(address);
+    if (entry == NULL) {
+        untracked++;
+        k_mutex_unlock(&table_lock);
+        return;
+    }
+    if (entry->packets == 0) {
+        entry->first_seen = now;
+    } else {
+        uint32_t interval = now - entry->last_seen;
+        if (entry->packets == 1) {
+            entry->interarrival_avg = interval;
+        } else {
+            entry->interarrival_avg += ((int32_t) (interval - entry->interarrival_avg))
+                                       >> INTERARRIVAL_SHIFT;
+        }
+        entry->interarrival_max = MAX(entry->interarrival_max, interval);
+    }
+    entry->last_seen = now;
+    entry->packets++;
+    entry->bytes += length;
+    if (sequence != NULL) {
+        update_sequence(entry, *sequence);
+    }
+    k_mutex_unlock(&table_lock);
+}
+
+uint32_t source_stats_for_each(
+    source_stats_fn fn,
+    void *ctx)
+{
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        struct source_stats_entry entry;
+
+        k_mutex_lock(&table_lock, K_FOREVER);
+        entry = table[i];
+        k_mutex_unlock(&table_lock);
+        if (entry.used) {
+            fn(&entry, ctx);
+        }
+    }
+    k_mutex_lock(&table_lock, K_FOREVER);
+    uint32_t count = untracked;
+    k_mutex_unlock(&table_lock);
+    return count;
+}
+
+void source_stats_reset(
+    void)
+{
+    k_mutex_lock(&table_lock, K_FOREVER);
+    memset(table, 0, sizeof(table));
+    untracked = 0;
+    k_mutex_unlock(&table_lock);
+}
+
+/* Print to the shell running a command, or to the console without one */
+static void print_line(
+    const struct shell *sh,
+    const char *fmt,
+    ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+#if CONFIG_SHELL
+    if (sh != NULL) {
+        shell_vfprintf(sh, SHELL_NORMAL, fmt, args);
+        va_end(args);
+        return;
+    }
+#endif
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+static void print_entry(
+    const struct source_stats_entry *entry,
+    void *ctx)
+{
+    char buffer[MIRA_NET_MAX_ADDRESS_STR_LEN];
+
+    print_line(ctx, "%s: %u packets, %u bytes, last %u ms ago, interval avg %u max %u ms\n",
+        mira_net_toolkit_format_address(buffer, &entry->address),
+        entry->packets,
+        entry->bytes,
+        k_uptime_get_32() - entry->last_seen,
+        entry->interarrival_avg,
+        entry->interarrival_max);
+    if (entry->sequence_valid) {
+        print_line(ctx, "    seq %u, lost %u, duplicate %u, reordered %u, restarts %u\n",
+            entry->last_sequence,
+            entry->lost,
+            entry->duplicates,
+            entry->reordered,
+            entry->restarts);
+    }
+}
+
+static void print_table(
+    const struct shell *sh)
+{
+    uint32_t count = source_stats_for_each(print_entry, (void *) sh);
+    print_line(sh, "%u packets from sources not in the table\n", count);
+}
+
+void source_stats_print(
+    void)
+{
+    print_table(NULL);
+}
+
+#if CONFIG_SHELL
+static int cmd_sources(
+    const struct shell *sh,
+    size_t argc,
+    char **argv)
+{
+    print_table(sh);
+    return 0;
+}
+
+static int cmd_sources_reset(
+    const struct shell *sh,
+    size_t argc,
+    char **argv)
+{
+    source_stats_reset();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sources_cmds,
+    SHELL_CMD(reset, NULL, "Clear the table", cmd_sources_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(sources, &sources_cmds, "Show the packets received per source node",
+    cmd_sources);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef SOURCE_STATS_H
+#define SOURCE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <miramesh.h>
+
+/*
+ * Statistics per source node on the root, in a fixed size open
+ * addressing hash table keyed by the source address. Packets from new
+ * sources are only counted as untracked once the table is full.
+ */
+struct source_stats_entry {
+    mira_net_address_t address;
+    bool used;
+    bool sequence_valid;
+    uint32_t packets;
+    uint32_t bytes;
+    /* Uptime of the first and last packet, ms */
+    uint32_t first_seen;
+    uint32_t last_seen;
+    /* Smoothed and longest time between packets, ms */
+    uint32_t interarrival_avg;
+    uint32_t interarrival_max;
+    /* Sequence tracking, for packets that carry a sequence number */
+    uint32_t last_sequence;
+    uint32_t lost;
+    uint32_t duplicates;
+    uint32_t reordered;
+    uint32_t restarts;
+};
+
+/**
+ * Count a packet from a source. Called from the root receive thread.
+ *
+ * @param sequence Sequence number of the packet, or NULL if it has none.
+ *                 A sequence number of 0 restarts the sequence, as after
+ *                 a reboot of the sender.
+ */
+void source_stats_update(
+    const mira_net_address_t *address,
+    uint16_t length,
+    const uint32_t *sequence);
+
+/**
+ * Function receiving a copy of a table entry.
+ */
+typedef void (*source_stats_fn)(
+    const struct source_stats_entry *entry,
+    void *ctx);
+
+/**
+ * Call a function for a copy of every entry in use.
+ *
+ * @return Number of packets from sources that did not fit in the table.
+ */
+uint32_t source_stats_for_each(
+    source_stats_fn fn,
+    void *ctx);
+
+/**
+ * Print every entry in use to the console, like the sources shell
+ * command.
+ */
+void source_stats_print(
+    void);
+
+/**
+ * Empty the table.
+ */
+void source_stats_reset(
+    void);
+
+#endif /* SOURCE_STATS_H */
@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uplink.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <errno.h>
+#include <miramesh.h>
+
+/* A record was buffered */
+#define UPLINK_EVENT_QUEUED BIT(0)
+/* uplink_flush was called */
+#define UPLINK_EVENT_FLUSH BIT(1)
+
+/* Wait before sending again after a failed send, e.g. while not joined */
+#define SEND_RETRY_INTERVAL_MS 1000
+
+RING_BUF_DECLARE(uplink_ring, CONFIG_UPLINK_BATCH_BUFFER_SIZE);
+static K_MUTEX_DEFINE(uplink_lock);
+static K_EVENT_DEFINE(uplink_events);
+static struct uplink_stats stats;
+
+/* Uptime of the oldest buffered record, the deadline counts from it */
+static int64_t oldest_time;
+static int64_t retry_time;
+
+static mira_net_udp_connection_t *conn;
+static uint8_t payload[CONFIG_UPLINK_BATCH_PAYLOAD_SIZE];
+
+extern const k_tid_t uplink_thread_id;
+
+int uplink_send(
+    const void *data,
+    uint8_t length)
+{
+    if (length > UPLINK_RECORD_MAX_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    k_mutex_lock(&uplink_lock, K_FOREVER);
+    if (ring_buf_space_get(&uplink_ring) < length + 1) {
+        stats.dropped++;
+        k_mutex_unlock(&uplink_lock);
+        return -ENOMEM;
+    }
+    if (ring_buf_is_empty(&uplink_ring)) {
+        oldest_time = k_uptime_get();
+    }
+    ring_buf_put(&uplink_ring, &length, 1);
+    ring_buf_put(&uplink_ring, data, length);
+    stats.records++;
+    k_mutex_unlock(&uplink_lock);
+
+    k_event_post(&uplink_events, UPLINK_EVENT_QUEUED);
+    return 0;
+}
+
+void uplink_flush(
+    void)
+{
+    k_event_post(&uplink_events, UPLINK_EVENT_FLUSH);
+}
+
+/*
+ * Copy the records at the head of the buffer that fit in one payload to
+ * the payload buffer, returns their size. They stay in the buffer until
+ * they are sent.
+ */
+static uint16_t peek_payload(
+    void)
+{
+    uint32_t available = ring_buf_peek(&uplink_ring, payload, sizeof(payload));
+    uint16_t length = 0;
+
+    while (length < available && length + 1 + payload[length] <= available) {
+        length += 1 + payload[length];
+    }
+    return length;
+}
+
+/*
+ * Send full payloads, or everything buffered with flush set. Stops at the
+ * first failed send.
+ */
+static void send_buffered(
+    bool flush)
+{
+    while (1) {
+        k_mutex_lock(&uplink_lock, K_FOREVER);
+        uint32_t buffered = ring_buf_size_get(&uplink_ring);
+        if (buffered == 0 || (!flush && buffered < sizeof(payload))) {
+            k_mutex_unlock(&uplink_lock);
+            return;
+        }
+        uint16_t length = peek_payload();
+        k_mutex_unlock(&uplink_lock);
+
+        mira_net_address_t root_address;
+        mira_status_t res = mira_net_get_root_address(&root_address);
+        if (res == MIRA_SUCCESS) {
+            res = mira_net_udp_send_to(conn, &root_address, UPLINK_UDP_PORT,
+                payload, length);
+        }
+
+        k_mutex_lock(&uplink_lock, K_FOREVER);
+        if (res != MIRA_SUCCESS) {
+            stats.send_errors++;
+            retry_time = k_uptime_get() + SEND_RETRY_INTERVAL_MS;
+            k_mutex_unlock(&uplink_lock);
+            return;
+        }
+        ring_buf_get(&uplink_ring, NULL, length);
+        stats.datagrams++;
+        stats.bytes += length;
+        /*
+         * The remaining records were buffered after the sent ones, their
+         * deadline is counted from now.
+         */
+        oldest_time = k_uptime_get();
+        k_mutex_unlock(&uplink_lock);
+    }
+}
+
+static void uplink_thread(
+    void)
+{
+    while (1) {
+        k_timeout_t timeout = K_FOREVER;
+
+        k_mutex_lock(&uplink_lock, K_FOREVER);
+        if (!ring_buf_is_empty(&uplink_ring)) {
+            int64_t deadline = MAX(oldest_time + CONFIG_UPLINK_BATCH_MAX_LATENCY_MS,
+                retry_time);
+            timeout = K_MSEC(MAX(deadline - k_uptime_get(), 0));
+        }
+        k_mutex_unlock(&uplink_lock);
+
+        uint32_t events = k_event_wait(&uplink_events,
+            UPLINK_EVENT_QUEUED | UPLINK_EVENT_FLUSH,
+            false,
+            timeout);
+        if (events != 0) {
+            k_event_clear(&uplink_events, events);
+        }
+        if (events & UPLINK_EVENT_FLUSH) {
+            send_buffered(true);
+        } else if (k_uptime_get() >= retry_time) {
+            /* No event means the deadline of the oldest record passed */
+            send_buffered(events == 0);
+        }
+    }
+}
+
+K_THREAD_DEFINE(uplink_thread_id,
+    CONFIG_UPLINK_BATCH_STACK_SIZE,
+    uplink_thread,
+    NULL,
+    NULL,
+    NULL,
+    CONFIG_UPLINK_BATCH_PRIORITY,
+    0,
+    SYS_FOREVER_MS);
+
+void uplink_init(
+    void)
+{
+    conn = mira_net_udp_connect(NULL, 0, NULL, NULL);
+    k_thread_start(uplink_thread_id);
+}
+
+int uplink_parse(
+    const void *data,
+    uint16_t length,
+    uplink_record_fn record_fn,
+    void *ctx)
+{
+    const uint8_t *bytes = data;
+    uint16_t pos = 0;
+
+    while (pos < length) {
+        uint8_t record_length = bytes[pos];
+        if (record_length > length - pos - 1) {
+            return -EINVAL;
+        }
+        record_fn(&bytes[pos + 1], record_length, ctx);
+        pos += 1 + record_length;
+    }
+    return 0;
+}
+
+void uplink_get_stats(
+    struct uplink_stats *out)
+{
+    k_mutex_lock(&uplink_lock, K_FOREVER);
+    *out = stats;
+    out->buffered = ring_buf_size_get(&uplink_ring);
+    k_mutex_unlock(&uplink_lock);
+}
@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stdint.h>
+
+/*
+ * Batching uplink to the root.
+ *
+ * Records are buffered and sent together in UDP datagrams of up to
+ * CONFIG_UPLINK_BATCH_PAYLOAD_SIZE bytes to UPLINK_UDP_PORT on the root.
+ * A payload is a sequence of records, each a length byte followed by the
+ * record data.
+ *
+ * A datagram is sent when a full payload is buffered, when the oldest
+ * buffered record is CONFIG_UPLINK_BATCH_MAX_LATENCY_MS old, or on
+ * uplink_flush.
+ */
+#define UPLINK_UDP_PORT 457
+#define UPLINK_RECORD_MAX_SIZE (CONFIG_UPLINK_BATCH_PAYLOAD_SIZE - 1)
+
+struct uplink_stats {
+    /* Records accepted by uplink_send */
+    uint32_t records;
+    /* Records rejected because the buffer was full */
+    uint32_t dropped;
+    /* Datagrams sent */
+    uint32_t datagrams;
+    /* Payload bytes sent */
+    uint32_t bytes;
+    /* Sends that failed, the records are sent again later */
+    uint32_t send_errors;
+    /* Bytes waiting in the buffer, out of CONFIG_UPLINK_BATCH_BUFFER_SIZE */
+    uint32_t buffered;
+};
+
+/**
+ * Function receiving the records of a received payload.
+ */
+typedef void (*uplink_record_fn)(
+    const uint8_t *data,
+    uint8_t length,
+    void *ctx);
+
+/**
+ * Open the UDP connection used by the sender thread and start sending.
+ */
+void uplink_init(
+    void);
+
+/**
+ * Buffer a record for the root. Not callable from interrupts.
+ *
+ * @return 0 on success, -EMSGSIZE if the record is larger than
+ *         UPLINK_RECORD_MAX_SIZE, -ENOMEM if the buffer is full.
+ */
+int uplink_send(
+    const void *data,
+    uint8_t length);
+
+/**
+ * Send all buffered records without waiting for the deadline.
+ */
+void uplink_flush(
+    void);
+
+/**
+ * Split a received payload into its records.
+ *
+ * @return 0 on success, -EINVAL if the payload ends inside a record.
+ */
+int uplink_parse(
+    const void *data,
+    uint16_t length,
+    uplink_record_fn record_fn,
+    void *ctx);
+
+void uplink_get_stats(
+    struct uplink_stats *stats);
+
+#endif /* UPLINK_H */
@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+
+"""Tests of config2hex.py, run with python3 -m unittest from this directory"""
+
+import io
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+import zlib
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+sys.path.insert(0, REPO)
+
+import config2hex  # noqa: E402
+
+try:
+    from intelhex import IntelHex
+except ImportError:
+    IntelHex = None
+
+NODE_CONFIG_H = os.path.join(REPO, "src", "node_config", "node_config.h")
+CONFIGS = os.path.join(REPO, "mira_network_configs")
+
+# Field names of config2hex.py for the firmware's node_config_type
+FIRMWARE_NAMES = {
+    "MODE": "mode",
+    "PAN_ID": "pan_id",
+    "KEY": "key",
+    "RATE": "rate",
+    "ANTENNA": "antenna",
+    "UDP_PORT": "udp_port",
+    "SEND_INTERVAL": "send_interval_ms",
+}
+
+ALL_FIELDS = """
+mode = leaf
+pan_id = 0x13243546
+key = 11121314212223243132333441424344
+rate = slow
+antenna = 1
+udp_port = 456
+send_interval_ms = 60000
+"""
+
+# Encoded by hand from the layout in node_config.h
+GOLDEN_MODE_ONLY = bytes.fromhex(
+    "4d5a4346"  # "MZCF"
+    "01"  # version
+    "00"  # reserved
+    "0300"  # length of the fields
+    "f2b29f90"  # CRC32 of the fields
+    "010101"  # mode = root
+)
+GOLDEN_ALL_FIELDS = bytes.fromhex(
+    "4d5a4346" "01" "00" "2b00" "469c4c85"
+    "010103"  # mode = leaf
+    "020446352413"  # pan_id
+    "031011121314212223243132333441424344"  # key
+    "040102"  # rate = slow
+    "050101"  # antenna
+    "0602c801"  # udp_port
+    "070460ea0000"  # send_interval_ms
+)
+
+
+def parse(text):
+    return config2hex.read_file(io.StringIO(text))
+
+
+def with_crc(data):
+    """Header CRC updated to the fields, so only the other checks fail"""
+    data = bytearray(data)
+    length = struct.unpack_from("<H", data, 6)[0]
+    fields = data[config2hex.CONFIG_HEADER_SIZE:config2hex.CONFIG_HEADER_SIZE + length]
+    struct.pack_into("<I", data, 8, zlib.crc32(fields))
+    return bytes(data)
+
+
+class EncodeTest(unittest.TestCase):
+    def test_mode_only(self):
+        self.assertEqual(config2hex.encode({"mode": 1}), GOLDEN_MODE_ONLY)
+
+    def test_all_fields(self):
+        self.assertEqual(config2hex.encode(parse(ALL_FIELDS)), GOLDEN_ALL_FIELDS)
+
+    def test_legacy_file(self):
+        self.assertEqual(config2hex.encode(parse("1\n")), GOLDEN_MODE_ONLY)
+
+    def test_shipped_configs(self):
+        for name in sorted(os.listdir(CONFIGS)):
+            with self.subTest(name), open(os.path.join(CONFIGS, name)) as f:
+                values = config2hex.read_file(f)
+                self.assertIn("mode", values)
+                self.assertEqual(config2hex.decode(config2hex.encode(values)), values)
+
+
+class DecodeTest(unittest.TestCase):
+    def test_golden(self):
+        self.assertEqual(config2hex.decode(GOLDEN_ALL_FIELDS), parse(ALL_FIELDS))
+
+    def test_padding_ignored(self):
+        padded = config2hex.add_padding(GOLDEN_MODE_ONLY, 0x1000)
+        self.assertEqual(len(padded), 0x1000)
+        self.assertEqual(config2hex.decode(padded), {"mode": 1})
+
+    def test_bad_magic(self):
+        with self.assertRaisesRegex(ValueError, "magic"):
+            config2hex.decode(b"MZCG" + GOLDEN_MODE_ONLY[4:])
+        with self.assertRaisesRegex(ValueError, "magic"):
+            config2hex.decode(bytes([0xFF]) * 0x1000)
+
+    def test_truncated(self):
+        for length in range(4, config2hex.CONFIG_HEADER_SIZE):
+            with self.subTest(length), self.assertRaisesRegex(ValueError, "truncated"):
+                config2hex.decode(GOLDEN_ALL_FIELDS[:length])
+        for length in range(config2hex.CONFIG_HEADER_SIZE, len(GOLDEN_ALL_FIELDS)):
+            with self.subTest(length), self.assertRaisesRegex(ValueError, "truncated"):
+                config2hex.decode(GOLDEN_ALL_FIELDS[:length])
+
+    def test_wrong_version(self):
+        for version in (0, 2, 0xFF):
+            data = bytearray(GOLDEN_ALL_FIELDS)
+            data[4] = version
+            with self.subTest(version), self.assertRaisesRegex(ValueError, "version"):
+                config2hex.decode(bytes(data))
+
+    def test_bad_crc(self):
+        for pos in range(config2hex.CONFIG_HEADER_SIZE, len(GOLDEN_ALL_FIELDS)):
+            data = bytearray(GOLDEN_ALL_FIELDS)
+            data[pos] ^= 0x01
+            with self.subTest(pos), self.assertRaisesRegex(ValueError, "CRC"):
+                config2hex.decode(bytes(data))
+        data = bytearray(GOLDEN_ALL_FIELDS)
+        data[8] ^= 0x80
+        with self.assertRaisesRegex(ValueError, "CRC"):
+            config2hex.decode(bytes(data))
+
+    def test_field_overrun(self):
+        # Length byte of the last field past the end, with a valid CRC
+        data = bytearray(GOLDEN_MODE_ONLY)
+        data[13] = 2
+        with self.assertRaisesRegex(ValueError, "overruns"):
+            config2hex.decode(with_crc(data))
+        # A type byte without its length
+        data = bytearray(GOLDEN_MODE_ONLY) + b"\x05"
+        data[6] = 4
+        with self.assertRaisesRegex(ValueError, "overruns"):
+            config2hex.decode(with_crc(data))
+
+    def test_unknown_field_skipped(self):
+        data = bytearray(GOLDEN_MODE_ONLY) + bytes([0x80, 2, 0xAA, 0xBB])
+        data[6] += 4
+        self.assertEqual(config2hex.decode(with_crc(data)), {"mode": 1})
+
+
+class ReadFileTest(unittest.TestCase):
+    def test_comments_and_names(self):
+        values = parse("# comment\nmode = mesh # trailing\nrate = 1\n\nudp_port=0x1c8\n")
+        self.assertEqual(values, {"mode": 4, "rate": 1, "udp_port": 456})
+
+    def test_errors(self):
+        for text, message in (
+            ("mode = root\nmode = leaf\n", "set twice"),
+            ("colour = red\n", "unknown field"),
+            ("mode = gateway\n", "expected one of"),
+            ("rate = 3\n", "expected one of"),
+            ("udp_port = 65536\n", "does not fit"),
+            ("antenna = -1\n", "does not fit"),
+            ("key = 0011\n", "32 hex digits"),
+            ("mode = root\n3\n", "expected name = value"),
+        ):
+            with self.subTest(text), self.assertRaisesRegex(ValueError, message):
+                parse(text)
+
+
+class FirmwareLayoutTest(unittest.TestCase):
+    """config2hex.py against what src/node_config parses"""
+
+    @classmethod
+    def setUpClass(cls):
+        with open(NODE_CONFIG_H) as f:
+            cls.header = f.read()
+
+    def define(self, name):
+        match = re.search(r"#define %s (\w+)" % name, self.header)
+        self.assertIsNotNone(match, name)
+        return int(match.group(1), 0)
+
+    def test_header(self):
+        self.assertEqual(self.define("NODE_CONFIG_MAGIC"),
+                         struct.unpack("<I", config2hex.CONFIG_MAGIC)[0])
+        self.assertEqual(self.define("NODE_CONFIG_VERSION"), config2hex.CONFIG_VERSION)
+        self.assertEqual(self.define("NODE_CONFIG_HEADER_SIZE"), config2hex.CONFIG_HEADER_SIZE)
+
+    def test_header_table(self):
+        rows = re.findall(r"^ \* (\d+) +\| (\d+) +\| (.+)$", self.header, re.M)
+        layout = [(int(offset), int(size)) for offset, size, _ in rows]
+        # Magic, version, reserved, length and CRC, as packed by encode()
+        self.assertEqual(layout, [(0, 4), (4, 1), (5, 1), (6, 2), (8, 4)])
+        self.assertEqual(4 + struct.calcsize("<BBHI"), config2hex.CONFIG_HEADER_SIZE)
+
+    def test_field_types_and_sizes(self):
+        sizes = {"uint8_t": 1, "uint16_t": 2, "uint32_t": 4}
+        # The comment of each type starts with the C type of its value
+        entries = re.findall(r"/\* (.*?) \*/\s*NODE_CONFIG_(\w+) = (\d+),", self.header)
+        self.assertEqual({name for _, name, _ in entries}, set(FIRMWARE_NAMES))
+        self.assertEqual(len(entries), len(config2hex.FIELDS))
+        for comment, name, number in entries:
+            kind = comment.split(",")[0]
+            field = FIRMWARE_NAMES[name]
+            field_type, _, fmt = config2hex.FIELDS[field]
+            with self.subTest(field):
+                self.assertEqual(field_type, int(number))
+                if fmt is None:
+                    self.assertEqual(kind, "16 bytes")
+                else:
+                    self.assertEqual(struct.calcsize(fmt), sizes[kind])
+
+    def test_modes_and_rates(self):
+        for prefix, choices in (("MODE", config2hex.MODES), ("RATE", config2hex.RATES)):
+            defines = re.findall(r"#define NODE_CONFIG_%s_(\w+) (\d+)" % prefix, self.header)
+            self.assertEqual({name.lower(): int(value) for name, value in defines}, choices)
+
+    def test_crc_is_ieee(self):
+        # Check value of the CRC-32 crc32_ieee() computes
+        self.assertEqual(zlib.crc32(b"123456789"), 0xCBF43926)
+
+
+@unittest.skipIf(IntelHex is None, "intelhex is not installed, see requirements.txt")
+class CommandLineTest(unittest.TestCase):
+    ADDRESS = 0xFE000
+    LENGTH = 0x1000
+
+    def run_tool(self, *args):
+        return subprocess.run(
+            [sys.executable, os.path.join(REPO, "config2hex.py"),
+             "-f", os.path.join(CONFIGS, "root.config"),
+             "-a", hex(self.ADDRESS), "-l", hex(self.LENGTH)] + list(args),
+            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    def test_hex(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            out = os.path.join(tmp, "root.hex")
+            self.assertEqual(self.run_tool("-o", out).returncode, 0)
+            ih = IntelHex(out)
+        self.assertEqual(ih.minaddr(), self.ADDRESS)
+        self.assertEqual(ih.maxaddr(), self.ADDRESS + self.LENGTH - 1)
+        data = ih.tobinstr(start=self.ADDRESS, size=self.LENGTH)
+        self.assertEqual(data[:len(GOLDEN_MODE_ONLY)], GOLDEN_MODE_ONLY)
+        self.assertEqual(set(data[len(GOLDEN_MODE_ONLY):]), {0xFF})
+
+    def test_binary(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            out = os.path.join(tmp, "root.bin")
+            self.assertEqual(self.run_tool("-b", "-o", out).returncode, 0)
+            with open(out, "rb") as f:
+                data = f.read()
+        self.assertEqual(len(data), self.ADDRESS + self.LENGTH)
+        self.assertEqual(set(data[:self.ADDRESS]), {0xFF})
+        self.assertEqual(config2hex.decode(data[self.ADDRESS:]), {"mode": 1})
+
+    def test_too_long(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            result = self.run_tool("-o", os.path.join(tmp, "root.hex"), "-l", "8")
+        self.assertNotEqual(result.returncode, 0)
+        self.assertIn(b"does not fit", result.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
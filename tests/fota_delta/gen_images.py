@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+import os
+import random
+import struct
+import hashlib
+import argparse
+
+# MCUboot image layout, see fota_pack.py
+MCUBOOT_IMAGE_MAGIC = 0x96F3B83D
+MCUBOOT_HDR_SIZE = 0x200
+MCUBOOT_TLV_INFO_MAGIC = 0x6907
+MCUBOOT_TLV_PROT_INFO_MAGIC = 0x6908
+MCUBOOT_TLV_KEYHASH = 0x01
+MCUBOOT_TLV_SHA256 = 0x10
+MCUBOOT_TLV_SEC_CNT = 0x50
+
+BODY_SIZE = 48 * 1024
+
+
+def tlv(tlv_type, data):
+    return struct.pack("<HH", tlv_type, len(data)) + data
+
+
+def mcuboot_image(body, version, security_counter):
+    """A signed-looking MCUboot image, with a protected TLV ahead of the hash"""
+    protected = tlv(MCUBOOT_TLV_SEC_CNT, struct.pack("<I", security_counter))
+    protected = struct.pack("<HH", MCUBOOT_TLV_PROT_INFO_MAGIC, 4 + len(protected)) + protected
+    header = struct.pack(
+        "<IIHHIIBBHI",
+        MCUBOOT_IMAGE_MAGIC,
+        0,  # load address
+        MCUBOOT_HDR_SIZE,
+        len(protected),
+        len(body),
+        0,  # flags
+        *version,
+        0,  # build number
+    )
+    header += bytes(MCUBOOT_HDR_SIZE - len(header))
+    digest = hashlib.sha256(header + body + protected).digest()
+    # The hash is not the first TLV, so the search has to skip one
+    tlvs = tlv(MCUBOOT_TLV_KEYHASH, hashlib.sha256(b"key").digest())
+    tlvs += tlv(MCUBOOT_TLV_SHA256, digest)
+    tlvs = struct.pack("<HH", MCUBOOT_TLV_INFO_MAGIC, 4 + len(tlvs)) + tlvs
+    return header + body + protected + tlvs, digest
+
+
+def firmware(rng, size):
+    """Code-like data: repeated instruction words with random operands"""
+    words = [rng.getrandbits(32) for _ in range(64)]
+    out = bytearray()
+    while len(out) < size:
+        word = rng.choice(words)
+        if rng.random() < 0.3:
+            word ^= rng.getrandbits(12)
+        out += struct.pack("<I", word)
+    return out[:size]
+
+
+def modify(rng, body):
+    """The next release: patched code, a new and a removed function, more data"""
+    body = bytearray(body)
+    for _ in range(200):
+        body[rng.randrange(len(body))] = rng.getrandbits(8)
+    insert_at = rng.randrange(len(body) // 4, len(body) // 2)
+    body[insert_at:insert_at] = firmware(rng, 1500)
+    remove_at = rng.randrange(len(body) // 2, 3 * len(body) // 4)
+    del body[remove_at:remove_at + 700]
+    # Addresses after the insertion shift, like relocated calls
+    for pos in range(insert_at, len(body) - 4, 256):
+        body[pos] = (body[pos] + 4) & 0xFF
+    body += firmware(rng, 3000)
+    return bytes(body)
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(
+        description="generate a base and target MCUboot image for the delta FOTA test"
+    )
+    parser.add_argument("outdir")
+    parser.add_argument("--seed", type=int, default=1)
+
+    args = parser.parse_args()
+    rng = random.Random(args.seed)
+    base_body = firmware(rng, BODY_SIZE)
+    base, base_hash = mcuboot_image(base_body, (1, 0, 0), 1)
+    target, _ = mcuboot_image(modify(rng, base_body), (1, 1, 0), 2)
+
+    os.makedirs(args.outdir, exist_ok=True)
+    for name, data in (("base.bin", base), ("base_hash.bin", base_hash), ("target.bin", target)):
+        with open(os.path.join(args.outdir, name), "wb") as f:
+            f.write(data)
@@ -0,0 +1,349 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 LumenRadio AB
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+/*
+ * Delta FOTA test.
+ *
+ * Runs the patcher and the MCUboot hash lookup against a base and target
+ * image generated at build time by gen_images.py and packed with
+ * fota_pack.py, first in RAM and then through the driver on the flash
+ * simulator.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
+#include <string.h>
+
+#include <miramesh.h>
+#include "fota_driver.h"
+#include "fota_decompress.h"
+#include "fota_delta.h"
+
+#define FLASH_PAGE_SIZE 0x1000
+
+static const uint8_t base_image[] = {
+#include "base.bin.inc"
+};
+
+static const uint8_t base_hash[] = {
+#include "base_hash.bin.inc"
+};
+
+static const uint8_t target_image[] = {
+#include "target.bin.inc"
+};
+
+/* fota_pack.py -i target.bin -b base.bin */
+static const uint8_t delta_container[] = {
+#include "delta.bin.inc"
+};
+
+struct patch_ctx {
+    const uint8_t *base;
+    uint32_t base_size;
+    uint8_t out[sizeof(target_image)];
+    uint32_t out_length;
+};
+
+static struct patch_ctx patch;
+static struct fota_decompress dec;
+static struct fota_delta delta;
+
+static int read_ram(
+    uint32_t address,
+    uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    struct patch_ctx *p = ctx;
+    if (address > p->base_size || length > p->base_size - address) {
+        return -EINVAL;
+    }
+    memcpy(data, &p->base[address], length);
+    return 0;
+}
+
+static int write_ram(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    struct patch_ctx *p = ctx;
+    if (length > sizeof(p->out) - p->out_length) {
+        return -EFBIG;
+    }
+    memcpy(&p->out[p->out_length], data, length);
+    p->out_length += length;
+    return 0;
+}
+
+static int feed_delta(
+    const uint8_t *data,
+    uint32_t length,
+    void *ctx)
+{
+    return fota_delta_feed(ctx, data, length);
+}
+
+static void patch_init(
+    const uint8_t *base,
+    uint32_t base_size)
+{
+    patch.base = base;
+    patch.base_size = base_size;
+    patch.out_length = 0;
+}
+
+static void delta_header_get(
+    struct fota_decompress_header *header,
+    struct fota_delta_header *delta_header)
+{
+    zassert_ok(fota_decompress_parse_header(delta_container, header));
+    zassert_true(header->flags & FOTA_DECOMPRESS_FLAG_DELTA);
+    fota_delta_parse_header(&delta_container[FOTA_DECOMPRESS_CONTAINER_HEADER_SIZE],
+        delta_header);
+}
+
+/* Patch base_image in RAM, passing the stream on in chunks */
+static int patch_in_ram(
+    uint32_t chunk_size,
+    uint32_t stream_size)
+{
+    struct fota_decompress_header header;
+    struct fota_delta_header delta_header;
+    delta_header_get(&header, &delta_header);
+
+    patch_init(base_image, sizeof(base_image));
+    fota_delta_init(&delta, &delta_header, read_ram, write_ram, &patch);
+    fota_decompress_init(&dec, &header, feed_delta, &delta);
+
+    const uint8_t *stream = &delta_container[header.stream_offset];
+    for (uint32_t offset = 0; offset < stream_size; offset += chunk_size) {
+        int ret = fota_decompress_feed(&dec, &stream[offset],
+            MIN(chunk_size, stream_size - offset));
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    int ret = fota_decompress_finish(&dec);
+    if (ret != 0) {
+        return ret;
+    }
+    return fota_delta_finish(&delta);
+}
+
+ZTEST(fota_delta, test_image_hash)
+{
+    uint8_t hash[FOTA_DELTA_HASH_SIZE];
+    uint32_t size;
+
+    patch_init(base_image, sizeof(base_image));
+    zassert_ok(fota_delta_image_hash(read_ram, &patch, hash, &size));
+    zassert_equal(size, sizeof(base_image));
+    zassert_mem_equal(hash, base_hash, sizeof(hash));
+
+    patch_init(target_image, sizeof(target_image));
+    zassert_ok(fota_delta_image_hash(read_ram, &patch, hash, &size));
+    zassert_equal(size, sizeof(target_image));
+    zassert_true(memcmp(hash, base_hash, sizeof(hash)) != 0);
+}
+
+ZTEST(fota_delta, test_image_hash_invalid)
+{
+    static uint8_t image[sizeof(base_image)];
+    uint8_t hash[FOTA_DELTA_HASH_SIZE];
+    uint32_t size;
+
+    /* Erased slot */
+    memset(image, 0xFF, sizeof(image));
+    patch_init(image, sizeof(image));
+    zassert_equal(fota_delta_image_hash(read_ram, &patch, hash, &size), -ENOENT);
+
+    /* Broken TLV area */
+    memcpy(image, base_image, sizeof(image));
+    uint32_t tlv_offset = sys_get_le16(&image[8]) + sys_get_le32(&image[12])
+        + sys_get_le16(&image[10]);
+    image[tlv_offset] ^= 0xFF;
+    zassert_equal(fota_delta_image_hash(read_ram, &patch, hash, &size), -ENOENT);
+}
+
+ZTEST(fota_delta, test_delta_header)
+{
+    struct fota_decompress_header header;
+    struct fota_delta_header delta_header;
+    delta_header_get(&header, &delta_header);
+
+    zassert_equal(delta_header.image_size, sizeof(target_image));
+    zassert_equal(delta_header.base_size, sizeof(base_image));
+    zassert_mem_equal(delta_header.base_hash, base_hash, sizeof(base_hash));
+    zassert_equal(header.stream_offset + header.stream_size,
+        sizeof(delta_container));
+}
+
+ZTEST(fota_delta, test_patch)
+{
+    struct fota_decompress_header header;
+    struct fota_delta_header delta_header;
+    delta_header_get(&header, &delta_header);
+
+    /* Records and runs split at every possible place */
+    static const uint32_t chunk_sizes[] = {
+        1, 7, 13, 256, FLASH_PAGE_SIZE, sizeof(delta_container)
+    };
+    for (int i = 0; i < ARRAY_SIZE(chunk_sizes); i++) {
+        zassert_ok(patch_in_ram(chunk_sizes[i], header.stream_size),
+            "chunk size %u", chunk_sizes[i]);
+        zassert_equal(patch.out_length, sizeof(target_image));
+        zassert_mem_equal(patch.out, target_image, sizeof(target_image),
+            "chunk size %u", chunk_sizes[i]);
+    }
+}
+
+ZTEST(fota_delta, test_patch_truncated)
+{
+    struct fota_decompress_header header;
+    struct fota_delta_header delta_header;
+    delta_header_get(&header, &delta_header);
+
+    zassert_equal(patch_in_ram(FLASH_PAGE_SIZE, header.stream_size / 2), -EINVAL);
+    zassert_true(patch.out_length < sizeof(target_image));
+}
+
+static int feed_record(
+    uint32_t diff_length,
+    uint32_t extra_length,
+    int32_t seek)
+{
+    uint8_t record[FOTA_DELTA_RECORD_SIZE];
+    sys_put_le32(diff_length, &record[0]);
+    sys_put_le32(extra_length, &record[4]);
+    sys_put_le32((uint32_t) seek, &record[8]);
+    return fota_delta_feed(&delta, record, sizeof(record));
+}
+
+ZTEST(fota_delta, test_patch_corrupt)
+{
+    struct fota_delta_header header = {
+        .image_size = sizeof(target_image),
+        .base_size = sizeof(base_image),
+    };
+
+    /* Diff past the end of the base */
+    patch_init(base_image, sizeof(base_image));
+    fota_delta_init(&delta, &header, read_ram, write_ram, &patch);
+    zassert_equal(feed_record(sizeof(base_image) + 1, 0, 0), -EINVAL);
+
+    /* More data than the image holds */
+    fota_delta_init(&delta, &header, read_ram, write_ram, &patch);
+    zassert_equal(feed_record(0, sizeof(target_image) + 1, 0), -EINVAL);
+
+    /* Seek before the start of the base */
+    fota_delta_init(&delta, &header, read_ram, write_ram, &patch);
+    zassert_equal(feed_record(0, 0, -1), -EINVAL);
+
+    /* Records after the image is complete */
+    header.image_size = 0;
+    fota_delta_init(&delta, &header, read_ram, write_ram, &patch);
+    zassert_equal(feed_record(0, 0, 0), -EINVAL);
+    zassert_equal(patch.out_length, 0);
+}
+
+static void flash_load(
+    const struct flash_area *fa,
+    uint32_t offset,
+    const uint8_t *data,
+    uint32_t length)
+{
+    zassert_ok(flash_area_erase(fa, offset, ROUND_UP(length, FLASH_PAGE_SIZE)));
+    zassert_ok(flash_area_write(fa, offset, data, length));
+}
+
+static void flash_check(
+    const struct flash_area *fa,
+    const uint8_t *data,
+    uint32_t length)
+{
+    static uint8_t buf[FLASH_PAGE_SIZE];
+    for (uint32_t offset = 0; offset < length; offset += sizeof(buf)) {
+        uint32_t n = MIN(sizeof(buf), length - offset);
+        zassert_ok(flash_area_read(fa, offset, buf, n));
+        zassert_mem_equal(buf, &data[offset], n, "mismatch at %u", offset);
+    }
+}
+
+ZTEST(fota_delta, test_expand_second_slot)
+{
+    const struct flash_area *slot0;
+    const struct flash_area *swap;
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot0_partition), &slot0));
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &swap));
+
+    /* The running image, and the container uploaded with mcumgr */
+    flash_load(slot0, 0, base_image, sizeof(base_image));
+    flash_load(swap, 0, delta_container, sizeof(delta_container));
+
+    zassert_ok(fota_driver_stage_compressed_upload());
+    zassert_ok(fota_driver_expand_second_slot());
+    flash_check(swap, target_image, sizeof(target_image));
+
+    flash_area_close(swap);
+    flash_area_close(slot0);
+}
+
+ZTEST(fota_delta, test_expand_wrong_base)
+{
+    const struct flash_area *slot0;
+    const struct flash_area *swap;
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot0_partition), &slot0));
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &swap));
+
+    /* Running a different release than the delta was made against */
+    flash_load(slot0, 0, target_image, sizeof(target_image));
+    flash_load(swap, 0, delta_container, sizeof(delta_container));
+
+    zassert_ok(fota_driver_stage_compressed_upload());
+    zassert_equal(fota_driver_expand_second_slot(), -EILSEQ);
+    /* Left as it was, nothing is expanded */
+    flash_check(swap, delta_container, sizeof(delta_container));
+
+    flash_area_close(swap);
+    flash_area_close(slot0);
+}
+
+static void *fota_delta_setup(
+    void)
+{
+    fota_driver_set_custom_driver();
+    zassert_equal(mira_fota_init(), MIRA_SUCCESS);
+    return NULL;
+}
+
+ZTEST_SUITE(fota_delta, NULL, fota_delta_setup, NULL, NULL, NULL);